@@ -0,0 +1,128 @@
+#include "alloc_hooks.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+void Count(size_t size) {
+	const size_t subsystem = static_cast<size_t>(alloc_subsystem);
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	subsystem_allocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+	subsystem_allocated_bytes[subsystem].fetch_add(size, std::memory_order_relaxed);
+	++thread_allocation_count;
+	++thread_subsystem_allocations[subsystem];
+	thread_subsystem_allocated_bytes[subsystem] += size;
+}
+
+void* AlignedMalloc(size_t size, size_t alignment) {
+#ifdef _WIN32
+	return _aligned_malloc(size ? size : 1, alignment);
+#else
+	// aligned_alloc wants the size to be a nonzero multiple of the alignment
+	return std::aligned_alloc(alignment, size == 0 ? alignment : (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+void AlignedFree(void* ptr) {
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+}
+
+void* operator new(size_t size) {
+	Count(size);
+	if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	Count(size);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+	return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+// over-aligned types, including what pmr upstream resources ask for, go through these
+void* operator new(size_t size, std::align_val_t alignment) {
+	Count(size);
+	if (void* ptr = AlignedMalloc(size, static_cast<size_t>(alignment))) return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	Count(size);
+	return AlignedMalloc(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept {
+	return operator new(size, alignment, tag);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+	AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+	AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+	AlignedFree(ptr);
+}
+
+void AllocGuard::EndTick() {
+	if (!enabled) return;
+	const AllocSnapshot delta = AllocSnapshot::Take() - tick_begin;
+	++ticks;
+	if (ticks <= warmup_ticks || delta.total == 0) return;
+
+	fprintf(stderr, "allocation in tick %llu after %llu warm-up ticks: %llu allocations\n",
+		static_cast<unsigned long long>(ticks), static_cast<unsigned long long>(warmup_ticks), static_cast<unsigned long long>(delta.total));
+	for (size_t i = 0; i < ALLOC_SUBSYSTEMS; ++i) {
+		if (delta.counts[i] != 0) {
+			fprintf(stderr, "  %-12s %llu allocations, %llu bytes\n", ALLOC_SUBSYSTEM_NAMES[i],
+				static_cast<unsigned long long>(delta.counts[i]), static_cast<unsigned long long>(delta.bytes[i]));
+		}
+	}
+	std::abort();
+}
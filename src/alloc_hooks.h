@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "concat.h"
+
+// Counting hooks on global operator new (alloc_hooks.cpp), attributed to whichever ALLOC_SCOPE is active on the thread.
+
+enum class AllocSubsystem : uint8_t
+{
+	OTHER,
+	SIMULATION,
+	BOSS_SHOOT,
+	BULLETS,
+	DRAW,
+	PRESENT,
+	COUNT
+};
+
+constexpr size_t ALLOC_SUBSYSTEMS = static_cast<size_t>(AllocSubsystem::COUNT);
+constexpr const char* ALLOC_SUBSYSTEM_NAMES[ALLOC_SUBSYSTEMS] = { "other", "simulation", "boss_shoot", "bullets", "draw", "present" };
+
+inline std::atomic<uint64_t> allocation_count{ 0 };
+inline std::array<std::atomic<uint64_t>, ALLOC_SUBSYSTEMS> subsystem_allocations{};
+inline std::array<std::atomic<uint64_t>, ALLOC_SUBSYSTEMS> subsystem_allocated_bytes{};
+inline thread_local AllocSubsystem alloc_subsystem = AllocSubsystem::OTHER;
+
+// The same counts for the calling thread alone, which is what AllocGuard checks.
+inline thread_local uint64_t thread_allocation_count = 0;
+inline thread_local std::array<uint64_t, ALLOC_SUBSYSTEMS> thread_subsystem_allocations{};
+inline thread_local std::array<uint64_t, ALLOC_SUBSYSTEMS> thread_subsystem_allocated_bytes{};
+
+struct AllocScope {
+	AllocSubsystem previous;
+
+	explicit AllocScope(AllocSubsystem subsystem) : previous(alloc_subsystem) { alloc_subsystem = subsystem; }
+	~AllocScope() { alloc_subsystem = previous; }
+};
+
+#define ALLOC_SCOPE(subsystem) AllocScope TBGJ4_CONCAT(alloc_scope_, __LINE__)(AllocSubsystem::subsystem)
+
+struct AllocSnapshot {
+	uint64_t total = 0;
+	std::array<uint64_t, ALLOC_SUBSYSTEMS> counts{}, bytes{};
+
+	static AllocSnapshot Take() {
+		AllocSnapshot snapshot;
+		snapshot.total = thread_allocation_count;
+		snapshot.counts = thread_subsystem_allocations;
+		snapshot.bytes = thread_subsystem_allocated_bytes;
+		return snapshot;
+	}
+
+	AllocSnapshot operator-(const AllocSnapshot& earlier) const {
+		AllocSnapshot delta;
+		delta.total = total - earlier.total;
+		for (size_t i = 0; i < ALLOC_SUBSYSTEMS; ++i) {
+			delta.counts[i] = counts[i] - earlier.counts[i];
+			delta.bytes[i] = bytes[i] - earlier.bytes[i];
+		}
+		return delta;
+	}
+};
+
+// Zero-allocation assertion mode: once warmup_ticks have passed, any tick that allocates on the thread
+// running it prints a per-subsystem breakdown and aborts. Enabled with TBGJ4_ASSERT_NO_ALLOC=<warm-up ticks>.
+struct AllocGuard {
+	bool enabled = false;
+	uint64_t warmup_ticks = 0, ticks = 0;
+	AllocSnapshot tick_begin;
+
+	void Configure(const char* warmup) {
+		enabled = warmup != nullptr;
+		warmup_ticks = 0;
+		for (const char* c = warmup; c != nullptr && *c >= '0' && *c <= '9'; ++c) warmup_ticks = warmup_ticks * 10 + (*c - '0');
+	}
+
+	void BeginTick() {
+		if (enabled) tick_begin = AllocSnapshot::Take();
+	}
+
+	void EndTick();
+};
+
+inline AllocGuard alloc_guard;
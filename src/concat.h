@@ -0,0 +1,5 @@
+#pragma once
+
+// Pastes after expanding, so TBGJ4_CONCAT(name_, __LINE__) gives each scope macro a unique variable.
+#define TBGJ4_CONCAT_INNER(a, b) a##b
+#define TBGJ4_CONCAT(a, b) TBGJ4_CONCAT_INNER(a, b)
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "cp437_8x8.h"
+
+// The font ships as CP437_8X8_BITS and is only expanded to a byte-per-pixel atlas when a window needs it.
+using FontAtlasPixels = std::array<unsigned char, CP437_8X8_WIDTH * CP437_8X8_HEIGHT>;
+
+constexpr unsigned char GlyphRow(unsigned char codepoint, size_t row) {
+	return CP437_8X8_BITS[(8 * (codepoint / 16) + row) * 16 + codepoint % 16];
+}
+
+// One byte per pixel, 0xff where the bit is set. Bit 7 of each byte lands leftmost.
+inline void ExpandFontAtlas(FontAtlasPixels& pixels) {
+	constexpr size_t BYTES = sizeof(CP437_8X8_BITS);
+	size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+	// two source bytes per step: broadcast each into 8 lanes, keep one bit per lane, widen it to 0xff
+	const __m128i lane_bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	for (; i + 2 <= BYTES; i += 2) {
+		const __m128i bytes = _mm_set_epi64x(static_cast<long long>(CP437_8X8_BITS[i + 1] * 0x0101010101010101ull), static_cast<long long>(CP437_8X8_BITS[i] * 0x0101010101010101ull));
+		const __m128i lit = _mm_cmpeq_epi8(_mm_and_si128(bytes, lane_bits), lane_bits);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels.data() + 8 * i), lit);
+	}
+#endif
+	// SWAR (little endian): spread the byte over 8 lanes, mask lane n to bit 7 - n, then widen nonzero lanes to 0xff
+	for (; i < BYTES; ++i) {
+		uint64_t lanes = CP437_8X8_BITS[i] * 0x0101010101010101ull & 0x0102040810204080ull;
+		lanes = ((lanes + 0x7f7f7f7f7f7f7f7full) | lanes) & 0x8080808080808080ull;
+		lanes = (lanes >> 7) * 0xff;
+		memcpy(pixels.data() + 8 * i, &lanes, 8);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Monotonic per-frame arena for transient containers. Reset() at the top of each frame releases
+// everything at once; containers allocated from it must not outlive the frame.
+// Requests that do not fit spill to the upstream heap and are freed normally.
+struct FrameArena : std::pmr::memory_resource {
+	static constexpr size_t CAPACITY = 256 * 1024;
+
+	alignas(std::max_align_t) std::array<std::byte, CAPACITY> buffer;
+	size_t used = 0, peak = 0;
+	uint64_t overflows = 0;
+	std::pmr::memory_resource* upstream = std::pmr::new_delete_resource();
+
+	void Reset() { used = 0; }
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		const size_t begin = (used + alignment - 1) & ~(alignment - 1);
+		if (begin + bytes <= CAPACITY) {
+			used = begin + bytes;
+			if (used > peak) peak = used;
+			return buffer.data() + begin;
+		}
+		++overflows;
+		return upstream->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+		const std::byte* p = static_cast<const std::byte*>(ptr);
+		if (p < buffer.data() || p >= buffer.data() + CAPACITY) {
+			upstream->deallocate(ptr, bytes, alignment);
+		}
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+inline FrameArena frame_arena;
@@ -0,0 +1,19 @@
+#include "frame_pipeline.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+
+bool PinCurrentThread(int cpu) {
+	if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+#else
+
+bool PinCurrentThread(int) { return false; }
+
+#endif
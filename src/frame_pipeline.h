@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "input.h"
+
+// Lock-free handoff between a simulation thread and the render thread (TBGJ4_PIPELINE=1). Frame n goes into
+// buffer n % 2 once the renderer has taken frame n - 1, with the input captured at that point.
+struct FramePipeline {
+	// frames finished by the simulation, and frames the renderer has started presenting
+	alignas(64) std::atomic<uint64_t> ready{ 0 };
+	alignas(64) std::atomic<uint64_t> taken{ 0 };
+	std::atomic<bool> stopping{ false };
+	std::array<InputSnapshot, 2> inputs;
+
+	// Simulation side: blocks until frame's buffer and input are free to use; false once stopping.
+	bool WaitToSimulate(uint64_t frame) {
+		for (uint64_t seen = taken.load(std::memory_order_acquire); seen < frame; seen = taken.load(std::memory_order_acquire)) {
+			if (stopping.load(std::memory_order_relaxed)) return false;
+			taken.wait(seen, std::memory_order_acquire);
+		}
+		return !stopping.load(std::memory_order_relaxed);
+	}
+
+	const InputSnapshot& Input(uint64_t frame) const { return inputs[frame % 2]; }
+
+	void Publish(uint64_t frame) {
+		ready.store(frame + 1, std::memory_order_release);
+		ready.notify_one();
+	}
+
+	// Render side: blocks until frame has been simulated.
+	void WaitForFrame(uint64_t frame) {
+		for (uint64_t seen = ready.load(std::memory_order_acquire); seen <= frame; seen = ready.load(std::memory_order_acquire)) {
+			ready.wait(seen, std::memory_order_acquire);
+		}
+	}
+
+	// Hands the next frame its input and lets the simulation start on it.
+	void Take(uint64_t frame, const InputSnapshot& input) {
+		inputs[(frame + 1) % 2] = input;
+		taken.store(frame + 1, std::memory_order_release);
+		taken.notify_one();
+	}
+
+	void Stop() {
+		stopping.store(true);
+		taken.fetch_add(1, std::memory_order_release);
+		taken.notify_one();
+	}
+};
+
+// Pins the calling thread to one CPU. Linux only; elsewhere, or for a negative cpu, it does nothing.
+bool PinCurrentThread(int cpu);
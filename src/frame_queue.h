@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Ring of tile plane snapshots passed from the game thread to one consumer thread without locks.
+// Push never waits: when the consumer has fallen SLOTS frames behind, the frame is dropped instead.
+struct FrameQueue {
+	static constexpr size_t SLOTS = 16;
+
+	size_t tiles = 0;
+	// per slot: codepoints then colors, tiles bytes each
+	std::vector<unsigned char> planes;
+	std::array<uint64_t, SLOTS> frames{};
+	// producer side only
+	uint64_t dropped = 0;
+
+	alignas(64) std::atomic<uint64_t> head{ 0 };
+	alignas(64) std::atomic<uint64_t> tail{ 0 };
+
+	// Not thread safe; call before the consumer starts.
+	void Resize(size_t tile_count) {
+		tiles = tile_count;
+		planes.assign(SLOTS * 2 * tiles, 0);
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+		dropped = 0;
+	}
+
+	bool Push(uint64_t frame, const unsigned char* codepoints, const unsigned char* colors) {
+		const uint64_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == SLOTS) {
+			++dropped;
+			return false;
+		}
+		unsigned char* slot = planes.data() + (h % SLOTS) * 2 * tiles;
+		memcpy(slot, codepoints, tiles);
+		memcpy(slot + tiles, colors, tiles);
+		frames[h % SLOTS] = frame;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side: the oldest snapshot, or nullptr when empty. Valid until Pop().
+	const unsigned char* Front(uint64_t& frame) const {
+		const uint64_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return nullptr;
+		frame = frames[t % SLOTS];
+		return planes.data() + (t % SLOTS) * 2 * tiles;
+	}
+
+	void Pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+};
@@ -0,0 +1,316 @@
+#include "gif_capture.h"
+
+#include "raylib.h"
+
+#include "font_atlas.h"
+#include "pallette.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+constexpr unsigned char FindBlack() {
+	for (size_t i = 0; i < PALLETTE_SIZE; ++i) {
+		if (PALLETTE[i].r == 0 && PALLETTE[i].g == 0 && PALLETTE[i].b == 0) return static_cast<unsigned char>(i);
+	}
+	return 0;
+}
+
+// what unlit glyph pixels are drawn with, matching the window's ClearBackground(BLACK)
+constexpr unsigned char BLACK_INDEX = FindBlack();
+
+void PutU16(std::vector<unsigned char>& out, size_t value) {
+	out.push_back(static_cast<unsigned char>(value));
+	out.push_back(static_cast<unsigned char>(value >> 8));
+}
+
+// GIF LZW with 8-bit pixels: codes grow from 9 to 12 bits, then the table is cleared.
+struct LzwEncoder {
+	static constexpr uint32_t CLEAR = 256, END = 257, MAX_CODE = 4095;
+	// open addressing over (prefix << 8 | pixel); twice the 4096 codes keeps probes short
+	static constexpr size_t TABLE = 8192;
+
+	std::vector<unsigned char>& out;
+	std::array<uint32_t, TABLE> keys{};
+	std::array<uint16_t, TABLE> codes{};
+	uint32_t max_code = END;
+	int code_size = 9;
+	uint32_t bits = 0;
+	int bit_count = 0;
+	std::array<unsigned char, 255> block{};
+	size_t block_size = 0;
+
+	explicit LzwEncoder(std::vector<unsigned char>& out) : out(out) {}
+
+	void Put(uint32_t code, int size) {
+		bits |= code << bit_count;
+		bit_count += size;
+		while (bit_count >= 8) {
+			block[block_size++] = static_cast<unsigned char>(bits);
+			bits >>= 8;
+			bit_count -= 8;
+			if (block_size == block.size()) FlushBlock();
+		}
+	}
+
+	void FlushBlock() {
+		out.push_back(static_cast<unsigned char>(block_size));
+		out.insert(out.end(), block.begin(), block.begin() + block_size);
+		block_size = 0;
+	}
+
+	void Reset() {
+		keys.fill(0);
+		max_code = END;
+		code_size = 9;
+	}
+
+	void Encode(const unsigned char* pixels, size_t count) {
+		out.push_back(8);
+		Reset();
+		Put(CLEAR, code_size);
+		uint32_t prefix = pixels[0];
+		for (size_t i = 1; i < count; ++i) {
+			// keys are stored plus one so zero marks an empty slot
+			const uint32_t key = (prefix << 8 | pixels[i]) + 1;
+			size_t slot = (key * 2654435761u) % TABLE;
+			while (keys[slot] != 0 && keys[slot] != key) slot = (slot + 1) % TABLE;
+			if (keys[slot] == key) {
+				prefix = codes[slot];
+				continue;
+			}
+			Put(prefix, code_size);
+			keys[slot] = key;
+			codes[slot] = static_cast<uint16_t>(++max_code);
+			if (max_code >= (1u << code_size)) ++code_size;
+			if (max_code == MAX_CODE) {
+				Put(CLEAR, code_size);
+				Reset();
+			}
+			prefix = pixels[i];
+		}
+		Put(prefix, code_size);
+		// a clear before the end code keeps the decoder from guessing at a code size change
+		Put(CLEAR, code_size);
+		Put(END, 9);
+		if (bit_count > 0) Put(0, 8 - bit_count);
+		if (block_size > 0) FlushBlock();
+		out.push_back(0);
+	}
+};
+
+}
+
+void GifCapture::Toggle(size_t grid_columns, size_t grid_rows, int fps) {
+	if (clip != nullptr && clip->capturing.load()) {
+		// the coordinator finishes the file on its own so the game does not wait for the encoders
+		clip->capturing.store(false);
+		return;
+	}
+	char path[32];
+	snprintf(path, sizeof(path), "tbgj4_clip_%03d.gif", clips++);
+	std::unique_ptr<GifClip> next = std::make_unique<GifClip>();
+	next->previous = std::move(clip);
+	if (next->Start(path, grid_columns, grid_rows, fps)) {
+		TraceLog(LOG_INFO, "GIF: capturing to %s", path);
+		clip = std::move(next);
+	}
+	else {
+		TraceLog(LOG_WARNING, "GIF: cannot open %s", path);
+		clip = std::move(next->previous);
+	}
+}
+
+void GifCapture::Stop() {
+	clip.reset();
+}
+
+bool GifClip::Start(const char* path, size_t grid_columns, size_t grid_rows, int fps) {
+	file = fopen(path, "wb");
+	if (file == nullptr) return false;
+	columns = grid_columns;
+	rows = grid_rows;
+	frames_per_second = fps;
+
+	std::vector<unsigned char> header{ 'G', 'I', 'F', '8', '9', 'a' };
+	PutU16(header, 8 * columns);
+	PutU16(header, 8 * rows);
+	// global color table of 256 entries, 8 bits per primary
+	header.insert(header.end(), { 0xf7, BLACK_INDEX, 0 });
+	for (size_t i = 0; i < 256; ++i) {
+		const Color color = i < PALLETTE_SIZE ? PALLETTE[i] : BLACK;
+		header.insert(header.end(), { color.r, color.g, color.b });
+	}
+	// loop forever
+	header.insert(header.end(), { 0x21, 0xff, 0x0b, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 });
+	fwrite(header.data(), 1, header.size(), file);
+
+	const size_t hardware = std::thread::hardware_concurrency();
+	// leave a core for the game thread
+	const size_t worker_count = std::clamp<size_t>(hardware > 1 ? hardware - 1 : 1, 1, MAX_WORKERS);
+	job_count = 2 * worker_count;
+
+	const size_t tiles = columns * rows;
+	queue.Resize(tiles);
+	shown.assign(2 * tiles, 0);
+	for (size_t i = 0; i < job_count; ++i) jobs[i].planes.resize(2 * tiles);
+
+	workers.reserve(worker_count);
+	for (size_t i = 0; i < worker_count; ++i) workers.emplace_back([this] { Work(); });
+	capturing.store(true);
+	coordinator = std::thread([this] { Coordinate(); });
+	return true;
+}
+
+void GifClip::Stop() {
+	capturing.store(false);
+	if (coordinator.joinable()) coordinator.join();
+}
+
+void GifClip::ReapPrevious(bool wait) {
+	if (previous == nullptr || (!wait && !previous->finished.load(std::memory_order_acquire))) return;
+	previous.reset();
+}
+
+void GifClip::Coordinate() {
+	uint64_t end_frame = 0;
+	for (;;) {
+		uint64_t snapshot_frame;
+		const unsigned char* planes = queue.Front(snapshot_frame);
+		if (planes != nullptr) {
+			Submit(snapshot_frame, planes);
+			queue.Pop();
+			end_frame = snapshot_frame + 1;
+		}
+		else if (!capturing.load(std::memory_order_acquire) && queue.Front(snapshot_frame) == nullptr) {
+			break;
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(4));
+		}
+		WriteFinished(false, 0);
+		ReapPrevious(false);
+	}
+	while (written < submitted) WriteFinished(true, end_frame);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_ready.notify_all();
+	for (std::thread& worker : workers) worker.join();
+	workers.clear();
+	fputc(0x3b, file);
+	fclose(file);
+	file = nullptr;
+	TraceLog(LOG_INFO, "GIF: clip finished");
+	ReapPrevious(true);
+	finished.store(true, std::memory_order_release);
+}
+
+void GifClip::Submit(uint64_t snapshot_frame, const unsigned char* planes) {
+	if (submitted > 0 && Centiseconds(snapshot_frame) - Centiseconds(last_submitted_frame) < MIN_DELAY_CS) return;
+
+	// crop to the tiles that differ from the last submitted frame; the first frame is sent whole
+	const size_t tiles = columns * rows;
+	size_t left = columns, top = rows, right = 0, bottom = 0;
+	for (size_t y = 0; y < rows; ++y) {
+		for (size_t x = 0; x < columns; ++x) {
+			const size_t i = y * columns + x;
+			if (submitted > 0 && planes[i] == shown[i] && planes[tiles + i] == shown[tiles + i]) continue;
+			left = std::min(left, x);
+			right = std::max(right, x + 1);
+			top = std::min(top, y);
+			bottom = std::max(bottom, y + 1);
+		}
+	}
+	if (right == 0) return;
+
+	while (submitted - written == job_count) WriteFinished(true, 0);
+	Job& job = jobs[submitted % job_count];
+	job.frame = snapshot_frame;
+	job.x = left;
+	job.y = top;
+	job.width = right - left;
+	job.height = bottom - top;
+	memcpy(job.planes.data(), planes, 2 * tiles);
+	memcpy(shown.data(), planes, 2 * tiles);
+	last_submitted_frame = snapshot_frame;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++submitted;
+	}
+	work_ready.notify_one();
+}
+
+void GifClip::Work() {
+	for (;;) {
+		std::unique_lock<std::mutex> lock(mutex);
+		work_ready.wait(lock, [this] { return stopping || taken < submitted; });
+		if (taken == submitted) return;
+		Job& job = jobs[taken++ % job_count];
+		lock.unlock();
+
+		Encode(job);
+
+		lock.lock();
+		job.done = true;
+		lock.unlock();
+		work_done.notify_all();
+	}
+}
+
+void GifClip::WriteFinished(bool wait, uint64_t end_frame) {
+	while (written < submitted) {
+		Job& job = jobs[written % job_count];
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (wait) work_done.wait(lock, [&job] { return job.done; });
+			if (!job.done) return;
+		}
+		// a frame lasts until the next one, so it can only be written once that one is known
+		uint64_t next_frame = end_frame;
+		if (written + 1 < submitted) next_frame = jobs[(written + 1) % job_count].frame;
+		if (next_frame == 0) return;
+
+		const uint64_t delay = std::max(Centiseconds(next_frame) - Centiseconds(job.frame), MIN_DELAY_CS);
+		// graphic control extension: keep the previous frame under this one, no transparency
+		const unsigned char control[] = { 0x21, 0xf9, 0x04, 0x04, static_cast<unsigned char>(delay), static_cast<unsigned char>(delay >> 8), 0x00, 0x00 };
+		fwrite(control, 1, sizeof(control), file);
+		fwrite(job.encoded.data(), 1, job.encoded.size(), file);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job.done = false;
+			++written;
+		}
+		wait = false;
+	}
+}
+
+void GifClip::Encode(Job& job) const {
+	const size_t width = 8 * job.width, height = 8 * job.height, tiles = columns * rows;
+	job.pixels.resize(width * height);
+	for (size_t ty = 0; ty < job.height; ++ty) {
+		for (size_t tx = 0; tx < job.width; ++tx) {
+			const size_t tile = (job.y + ty) * columns + job.x + tx;
+			const unsigned char codepoint = job.planes[tile], color = job.planes[tiles + tile];
+			unsigned char* pixel = job.pixels.data() + 8 * ty * width + 8 * tx;
+			for (size_t row = 0; row < 8; ++row, pixel += width) {
+				const unsigned char bits = GlyphRow(codepoint, row);
+				for (size_t column = 0; column < 8; ++column) pixel[column] = bits & (0x80 >> column) ? color : BLACK_INDEX;
+			}
+		}
+	}
+
+	job.encoded.clear();
+	job.encoded.push_back(0x2c);
+	PutU16(job.encoded, 8 * job.x);
+	PutU16(job.encoded, 8 * job.y);
+	PutU16(job.encoded, width);
+	PutU16(job.encoded, height);
+	job.encoded.push_back(0);
+	LzwEncoder encoder(job.encoded);
+	encoder.Encode(job.pixels.data(), job.pixels.size());
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "frame_queue.h"
+
+// One clip being captured or finished. A coordinator thread crops each queued frame to the changed tiles,
+// a worker pool rasterizes and LZW-encodes them, and the coordinator writes them out in order.
+struct GifClip {
+	static constexpr size_t MAX_WORKERS = 4;
+	// one being encoded and one waiting per worker
+	static constexpr size_t MAX_JOBS = 2 * MAX_WORKERS;
+	// viewers stretch anything shorter than 2/100 s, so frames closer than that are skipped
+	static constexpr uint64_t MIN_DELAY_CS = 2;
+
+	// buffers grow to the largest crop they have held
+	struct Job {
+		uint64_t frame = 0;
+		size_t x = 0, y = 0, width = 0, height = 0;
+		std::vector<unsigned char> planes, pixels, encoded;
+		bool done = false;
+	};
+
+	FrameQueue queue;
+	std::atomic<bool> capturing{ false };
+	// owned by the coordinator while the clip is open
+	FILE* file = nullptr;
+	size_t columns = 0, rows = 0;
+	int frames_per_second = 60;
+	uint64_t frame = 0;
+
+	std::thread coordinator;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable work_ready, work_done;
+	std::array<Job, MAX_JOBS> jobs;
+	size_t job_count = 0;
+	uint64_t submitted = 0, taken = 0, written = 0;
+	bool stopping = false;
+
+	// coordinator state
+	std::vector<unsigned char> shown;
+	uint64_t last_submitted_frame = 0;
+	// the clip before this one, still finishing; this clip's coordinator joins and frees it
+	std::unique_ptr<GifClip> previous;
+	std::atomic<bool> finished{ false };
+
+	bool Start(const char* path, size_t columns, size_t rows, int frames_per_second);
+	void Stop();
+	~GifClip() { Stop(); }
+
+	// colors are final palette indices, after any remapping
+	void Push(const unsigned char* codepoints, const unsigned char* colors) {
+		if (!capturing.load(std::memory_order_relaxed)) return;
+		queue.Push(frame++, codepoints, colors);
+	}
+
+private:
+	void Coordinate();
+	void ReapPrevious(bool wait);
+	void Work();
+	void Submit(uint64_t frame, const unsigned char* planes);
+	// Writes finished frames in order; with wait it blocks until at least one is written.
+	void WriteFinished(bool wait, uint64_t end_frame);
+	void Encode(Job& job) const;
+	uint64_t Centiseconds(uint64_t frame) const { return frame * 100 / static_cast<uint64_t>(frames_per_second); }
+};
+
+// Captures highlight clips straight to an animated GIF (F10 starts and stops). A clip still finishing when the
+// next one starts is handed to the new clip's coordinator.
+struct GifCapture {
+	std::unique_ptr<GifClip> clip;
+	int clips = 0;
+
+	// Starts a clip named tbgj4_clip_NNN.gif, or finishes the current one in the background.
+	void Toggle(size_t columns, size_t rows, int frames_per_second);
+	void Stop();
+	~GifCapture() { Stop(); }
+
+	void Push(const unsigned char* codepoints, const unsigned char* colors) {
+		if (clip != nullptr) clip->Push(codepoints, colors);
+	}
+};
+
+inline GifCapture gif_capture;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <bitset>
+
+#include "raylib.h"
+#include "terminal.h"
+
+// Keyboard and close requests from the window, or from the terminal when running in it.
+
+inline bool LiveKeyDown(int key) { return terminal.active ? terminal.KeyDown(key) : IsKeyDown(key); }
+
+inline bool LiveKeyPressed(int key) { return terminal.active ? terminal.KeyPressed(key) : IsKeyPressed(key); }
+
+inline bool LiveShouldClose() { return terminal.active ? terminal.quit : WindowShouldClose(); }
+
+// The input state as the render thread saw it once, handed to a simulation running on another thread.
+// While a thread has one installed, the functions below answer from it instead of the live state.
+struct InputSnapshot {
+	static constexpr size_t KEYS = Terminal::KEYS;
+
+	std::bitset<KEYS> down, pressed;
+	bool close = false;
+
+	void Capture() {
+		for (size_t key = 0; key < KEYS; ++key) {
+			down[key] = LiveKeyDown(static_cast<int>(key));
+			pressed[key] = LiveKeyPressed(static_cast<int>(key));
+		}
+		close = LiveShouldClose();
+	}
+};
+
+inline thread_local const InputSnapshot* input_snapshot = nullptr;
+
+inline bool KeyDown(int key) {
+	if (input_snapshot == nullptr) return LiveKeyDown(key);
+	return key >= 0 && static_cast<size_t>(key) < InputSnapshot::KEYS && input_snapshot->down[key];
+}
+
+inline bool KeyPressed(int key) {
+	if (input_snapshot == nullptr) return LiveKeyPressed(key);
+	return key >= 0 && static_cast<size_t>(key) < InputSnapshot::KEYS && input_snapshot->pressed[key];
+}
+
+inline bool ShouldClose() { return input_snapshot != nullptr ? input_snapshot->close : LiveShouldClose(); }
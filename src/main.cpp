@@ -1,29 +1,55 @@
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 
 #include <iostream>
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <cstring>
 #include <list>
+#include <memory_resource>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <cstdio>
+#include <thread>
 
 #include "pallette.h"
-#include "cp437_8x8.h"
-
-constexpr size_t WIDTH = 80;
-constexpr size_t HEIGHT = 60;
+#include "tilemap_shader.h"
+#include "random.h"
+#include "timer_wheel.h"
+#include "script.h"
+#include "profiler.h"
+#include "stats.h"
+#include "alloc_hooks.h"
+#include "frame_arena.h"
+#include "metrics.h"
+#include "perf_counters.h"
+#include "recorder.h"
+#include "gif_capture.h"
+#include "terminal.h"
+#include "input.h"
+#include "frame_pipeline.h"
+#include "font_atlas.h"
+#include "window_pacer.h"
+
+// Grid and tile size come from the TBGJ4_GRID CMake option; 80x60 tiles of 8 pixels is the original game.
+#ifndef TBGJ4_GRID_WIDTH
+#define TBGJ4_GRID_WIDTH 80
+#define TBGJ4_GRID_HEIGHT 60
+#endif
+#ifndef TBGJ4_TILE_SIZE
+#define TBGJ4_TILE_SIZE 8
+#endif
+
+constexpr size_t WIDTH = TBGJ4_GRID_WIDTH;
+constexpr size_t HEIGHT = TBGJ4_GRID_HEIGHT;
 constexpr size_t TOTAL_TILES = WIDTH * HEIGHT;
-constexpr float FONT_SIZE = 8;
+constexpr float FONT_SIZE = TBGJ4_TILE_SIZE;
 
 constexpr int FRAME_PER_SECOND = 60;
 
-const Image CP437_8X8{
-	CP437_8X8_DATA,
-	CP437_8X8_WIDTH,
-	CP437_8X8_HEIGHT,
-	1,
-	CP437_8X8_FORMAT
-};
-
 enum class Scene
 {
 	START_SCENE,
@@ -32,16 +58,87 @@ enum class Scene
 	VICTORY
 };
 
+// Palette remap layers; each tile records which layer's remap applies to it when presented.
+enum Layer : unsigned char {
+	LAYER_DEFAULT,
+	LAYER_PLAYER,
+	LAYER_BOSS_BODY_BASE,
+	LAYER_BOSS_BODY_COVER,
+	LAYER_BOSS_LEFT_WING_BASE,
+	LAYER_BOSS_LEFT_WING_COVER,
+	LAYER_BOSS_RIGHT_WING_BASE,
+	LAYER_BOSS_RIGHT_WING_COVER,
+	LAYER_COUNT
+};
+
+struct Cell {
+	unsigned char codepoint, color, layer;
+};
+
+// Horizontal run of opaque cells; data indexes the packed span planes.
+struct Span {
+	int row, start, length, data;
+};
+
+// Sprite with compile-time dimensions; MakeGroup precompiles its opaque cells into per-row spans.
+template <int W, int H>
 struct Group {
-	int width, offset_x, offset_y;
-	std::vector<unsigned char> codepoints;
-	std::vector<unsigned char> colors;
+	static constexpr int width = W, height = H;
+	static constexpr int MAX_SPANS = H * ((W + 1) / 2);
+
+	int offset_x, offset_y;
+	std::array<Cell, W * H> cells;
 
-	constexpr Group(int width, int offset_x, int offset_y, std::vector<unsigned char> codepoints, std::vector<unsigned char> colors) : width(width), offset_x(offset_x), offset_y(offset_y), codepoints(codepoints), colors(colors) {};
+	int span_count;
+	std::array<Span, MAX_SPANS> spans;
+	std::array<unsigned char, W * H> span_codepoints, span_colors, span_layers;
 };
 
-const Group PLAYER_GROUP = Group(
-	5, -2, -1,
+// Rebuilds the spans and packed planes from cells, for sprites composed at runtime.
+template <int W, int H>
+constexpr void EncodeSpans(Group<W, H>& group) {
+	group.span_count = 0;
+	int data = 0;
+	for (int row = 0; row < H; ++row) {
+		for (int column = 0; column < W;) {
+			if (group.cells[row * W + column].codepoint == 0x00) {
+				++column;
+				continue;
+			}
+			Span& span = group.spans[group.span_count++];
+			span = { row, column, 0, data };
+			for (; column < W && group.cells[row * W + column].codepoint != 0x00; ++column, ++span.length, ++data) {
+				group.span_codepoints[data] = group.cells[row * W + column].codepoint;
+				group.span_colors[data] = group.cells[row * W + column].color;
+				group.span_layers[data] = group.cells[row * W + column].layer;
+			}
+		}
+	}
+}
+
+template <int W, int H>
+constexpr Group<W, H> MakeGroup(int offset_x, int offset_y, const unsigned char (&codepoints)[W * H], const unsigned char (&colors)[W * H]) {
+	Group<W, H> group{ offset_x, offset_y, {}, 0, {}, {}, {}, {} };
+	for (int i = 0; i < W * H; ++i) {
+		group.cells[i] = { codepoints[i], colors[i], LAYER_DEFAULT };
+	}
+	EncodeSpans(group);
+	return group;
+}
+
+// Draws part into target at (x, y) tagged with layer; call EncodeSpans once all parts are in.
+template <int W, int H, int PW, int PH>
+constexpr void ComposeGroup(Group<W, H>& target, int x, int y, const Group<PW, PH>& part, Layer layer) {
+	for (int i = 0; i < PW * PH; ++i) {
+		const Cell& cell = part.cells[i];
+		const int column = x + part.offset_x + i % PW, row = y + part.offset_y + i / PW;
+		if (cell.codepoint == 0x00 || column < 0 || column >= W || row < 0 || row >= H) continue;
+		target.cells[column + row * W] = { cell.codepoint, cell.color, layer };
+	}
+}
+
+constexpr auto PLAYER_GROUP = MakeGroup<5, 4>(
+	-2, -1,
 	{
 		0x00, 0x00, 0xef, 0x00, 0x00,
 		0x00, 0xb4, 0x7f, 0xc3, 0x00,
@@ -56,8 +153,8 @@ const Group PLAYER_GROUP = Group(
 	}
 	);
 
-const Group BOSS_WING_BASE = Group(
-	16, 0, 1,
+constexpr auto BOSS_WING_BASE = MakeGroup<16, 9>(
+	0, 1,
 	{
 		0xda, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xbf,
 		0xb3, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb2, 0xb3,
@@ -84,8 +181,8 @@ const Group BOSS_WING_BASE = Group(
 	}
 	);
 
-const Group BOSS_WING_COVER = Group(
-	16, 0, 6,
+constexpr auto BOSS_WING_COVER = MakeGroup<16, 4>(
+	0, 6,
 	{
 		0xc3, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xc4, 0xb4,
 		0xb3, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb3,
@@ -102,8 +199,8 @@ const Group BOSS_WING_COVER = Group(
 	}
 	);
 
-const Group BOSS_BODY_BASE = Group(
-	14, 0, 0,
+constexpr auto BOSS_BODY_BASE = MakeGroup<14, 10>(
+	0, 0,
 	{
 		0x00, 0x00, 0x00, 0xc9, 0xcd, 0xcd, 0xcd, 0xcd, 0xcd, 0xcd, 0xbb, 0x00, 0x00, 0x00,
 		0x00, 0x00, 0xba, 0xba, 0x09, 0xcd, 0xcd, 0xcd, 0xcd, 0x09, 0xba, 0xba, 0x00, 0x00,
@@ -130,8 +227,8 @@ const Group BOSS_BODY_BASE = Group(
 	}
 	);
 
-const Group BOSS_BODY_COVER = Group(
-	8, 3, 8,
+constexpr auto BOSS_BODY_COVER = MakeGroup<8, 7>(
+	3, 8,
 	{
 		0x00, 0x2f, 0xb0, 0xb0, 0xb0, 0xb0, 0x5c, 0x00,
 		0x00, 0x2f, 0xb2, 0xb2, 0xb2, 0xb2, 0x5c, 0x00,
@@ -152,33 +249,241 @@ const Group BOSS_BODY_COVER = Group(
 	}
 	);
 
-struct Screen {
+constexpr PalletteRemap IDENTITY_REMAP = IdentityRemap();
+constexpr PalletteRemap FLASH_REMAP = SolidRemap(0xbf);
+const BlendRamp<8> DAMAGE_TINT({ 255, 0, 0, 255 }, 128);
+const BlendRamp<8> VICTORY_FADE({ 0, 0, 0, 255 }, 255);
+
+// Range checked in debug builds only; the blitter clips before writing.
+struct CheckedTiles {
+	template <typename Plane>
+	static unsigned char* Row(Plane& plane, size_t index, size_t length) {
+		if (index + length > plane.size()) throw std::out_of_range("tile row out of range");
+		return plane.data() + index;
+	}
+};
+
+struct UncheckedTiles {
+	template <typename Plane>
+	static unsigned char* Row(Plane& plane, size_t index, size_t) { return plane.data() + index; }
+};
+
+#ifdef NDEBUG
+using TileAccess = UncheckedTiles;
+#else
+using TileAccess = CheckedTiles;
+#endif
+
+// One line of a laid-out string: characters [offset, offset + length) go on row line.
+struct TextRun {
+	int line, offset, length;
+};
+
+// Line runs of immutable strings, keyed by pointer; both tables start over when either fills up.
+struct TextLayoutCache {
+	static constexpr size_t ENTRIES = 32;
+	static constexpr size_t RUNS = 512;
+
+	struct Layout {
+		const char* text;
+		int first_run, run_count;
+	};
+
+	std::array<Layout, ENTRIES> layouts;
+	std::array<TextRun, RUNS> runs;
+	size_t layout_count = 0, run_count = 0;
+
+	// nullptr when text has more lines than the whole run table
+	const Layout* Get(const char* text) {
+		for (size_t i = 0; i < layout_count; ++i) {
+			if (layouts[i].text == text) return &layouts[i];
+		}
+
+		size_t lines = 1;
+		for (const char* c = text; *c != '\0'; ++c) lines += *c == '\n';
+		if (lines > RUNS) return nullptr;
+		if (layout_count == ENTRIES || run_count + lines > RUNS) Clear();
+
+		Layout& layout = layouts[layout_count++];
+		layout = { text, static_cast<int>(run_count), static_cast<int>(lines) };
+		for (int line = 0, offset = 0;; ++line) {
+			int length = 0;
+			while (text[offset + length] != '\0' && text[offset + length] != '\n') ++length;
+			runs[run_count++] = { line, offset, length };
+			if (text[offset + length] == '\0') break;
+			offset += length + 1;
+		}
+		return &layout;
+	}
+
+	void Clear() { layout_count = run_count = 0; }
+};
+
+template <size_t COLUMNS, size_t ROWS>
+struct TileScreen {
+	static constexpr size_t WIDTH = COLUMNS;
+	static constexpr size_t HEIGHT = ROWS;
+	static constexpr size_t TOTAL_TILES = COLUMNS * ROWS;
+
+	using Plane = std::array<unsigned char, TOTAL_TILES>;
+
 	Texture2D cp437_8x8;
 
-	std::array<unsigned char, TOTAL_TILES> codepoints;
-	std::array<unsigned char, TOTAL_TILES> colors;
+	Plane codepoints;
+	Plane colors;
+	Plane layers;
+
+	TextLayoutCache text_layouts;
+
+	// Reset by ClearScreen. A tile is presented as PALLETTE[screen_remap[layer_remaps[layer][color]]].
+	std::array<PalletteRemap, LAYER_COUNT> layer_remaps;
+	PalletteRemap screen_remap;
+
+	// one GRAY_ALPHA texel per tile, expanded by TILEMAP_FRAGMENT_SHADER; quads per tile without it
+	Shader tilemap_shader;
+	Texture2D tile_texture, pallette_texture;
+	int font_location = -1, pallette_location = -1;
+	bool use_tilemap_shader = false;
+	mutable std::array<unsigned char, TOTAL_TILES * 2> tile_texels{};
+
+	// false when the game runs in a terminal, in which case there is no window or GL context
+	bool windowed = false;
+	// drawn at native size, then scaled to the window in one blit
+	RenderTexture2D target;
+	// One presented picture after every remap; frames with the same revision match.
+	struct Frame {
+		Plane codepoints, colors;
+		uint64_t revision = 0;
+	};
+	std::array<Frame, 2> frames;
 
-	Screen(const char* title) {
-		InitWindow(WIDTH * FONT_SIZE, HEIGHT * FONT_SIZE, title);
-		cp437_8x8 = LoadTextureFromImage(CP437_8X8);
+	// A composed screen kept aside to copy back later.
+	struct Snapshot {
+		Plane codepoints, colors, layers;
+		bool saved = false;
+	};
+
+	// Dirty tracking: edits counts writes to the planes, revision counts distinct resolved pictures.
+	uint64_t edits = 0, resolved_edits = 0, revision = 0;
+	std::array<PalletteRemap, LAYER_COUNT> resolved_remaps{};
+	// the snapshot the planes still hold untouched, as of restored_edits
+	const Snapshot* restored = nullptr;
+	uint64_t restored_edits = 0;
+	// render thread only: the revision last presented, which the render target also holds
+	mutable uint64_t presented_revision = 0;
+	// an idle window still presents once a second, for window systems that drop its contents when covered
+	static constexpr int IDLE_REFRESH_FRAMES = FRAME_PER_SECOND;
+	mutable int idle_frames = 0;
+
+	mutable std::chrono::steady_clock::time_point last_draw_screen;
+
+	TileScreen(const char* title) {
 		ClearScreen();
+		if (terminal.active) return;
+
+		windowed = true;
+		SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+		InitWindow(WIDTH * FONT_SIZE, HEIGHT * FONT_SIZE, title);
+		SetWindowMinSize(WIDTH * FONT_SIZE, HEIGHT * FONT_SIZE);
+		FontAtlasPixels atlas;
+		ExpandFontAtlas(atlas);
+		cp437_8x8 = LoadTextureFromImage({ atlas.data(), CP437_8X8_WIDTH, CP437_8X8_HEIGHT, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE });
+		target = LoadRenderTexture(WIDTH * FONT_SIZE, HEIGHT * FONT_SIZE);
+		SetTextureFilter(target.texture, TEXTURE_FILTER_POINT);
+
+		tilemap_shader = LoadShaderFromMemory(nullptr, TILEMAP_FRAGMENT_SHADER);
+		// raylib hands back its default shader when compiling or linking fails
+		use_tilemap_shader = tilemap_shader.id != rlGetShaderIdDefault();
+		if (!use_tilemap_shader) {
+			TraceLog(LOG_WARNING, "tilemap shader unavailable; drawing tiles on the CPU");
+			return;
+		}
+		font_location = GetShaderLocation(tilemap_shader, "font");
+		pallette_location = GetShaderLocation(tilemap_shader, "pallette");
+
+		tile_texture = LoadTextureFromImage({ tile_texels.data(), static_cast<int>(WIDTH), static_cast<int>(HEIGHT), 1, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA });
+		std::array<Color, 256> pallette_pixels;
+		pallette_pixels.fill({ 0, 0, 0, 255 });
+		std::copy(std::begin(PALLETTE), std::end(PALLETTE), pallette_pixels.begin());
+		pallette_texture = LoadTextureFromImage({ pallette_pixels.data(), 256, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 });
 	}
 
-	~Screen() {
+	~TileScreen() {
+		if (!windowed) return;
+		if (use_tilemap_shader) {
+			UnloadTexture(pallette_texture);
+			UnloadTexture(tile_texture);
+			UnloadShader(tilemap_shader);
+		}
+		UnloadRenderTexture(target);
 		UnloadTexture(cp437_8x8);
 		CloseWindow();
 	}
 
+	struct Clip {
+		int left, top, right, bottom;
+		bool Empty() const { return left >= right || top >= bottom; }
+	};
+
+	static constexpr Clip ClipRect(int x, int y, int w, int h) {
+		return { std::max(x, 0), std::max(y, 0), std::min(x + w, static_cast<int>(WIDTH)), std::min(y + h, static_cast<int>(HEIGHT)) };
+	}
+
+	struct RowSource {
+		const unsigned char* codepoints = nullptr;
+		const unsigned char* colors = nullptr;
+		const unsigned char* layers = nullptr;
+		unsigned char codepoint = 0x20, color = 0x00, layer = LAYER_DEFAULT;
+	};
+
+	// Writes length tiles starting at (x, y), already clipped by the caller.
+	void BlitRow(int x, int y, int length, const RowSource& source) {
+		const size_t tile = static_cast<size_t>(x) + static_cast<size_t>(y) * WIDTH;
+		++edits;
+		const auto write = [&](Plane& plane, const unsigned char* row, unsigned char value) {
+			unsigned char* destination = TileAccess::Row(plane, tile, length);
+			if (row != nullptr) memcpy(destination, row, length);
+			else memset(destination, value, length);
+		};
+		write(codepoints, source.codepoints, source.codepoint);
+		write(colors, source.colors, source.color);
+		write(layers, source.layers, source.layer);
+	}
+
 	void DrawTile(int x, int y, unsigned char codepoint, unsigned char color) {
-		if (x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT && codepoint != 0x00) {
-			codepoints.at(x + y * WIDTH) = codepoint;
-			colors.at(x + y * WIDTH) = color;
+		if (codepoint == 0x00 || ClipRect(x, y, 1, 1).Empty()) return;
+		BlitRow(x, y, 1, { .codepoint = codepoint, .color = color });
+	}
+
+	void FillRect(int x, int y, int w, int h, unsigned char codepoint, unsigned char color) {
+		const Clip clip = ClipRect(x, y, w, h);
+		if (codepoint == 0x00 || clip.Empty()) return;
+		for (int row = clip.top; row < clip.bottom; ++row) {
+			BlitRow(clip.left, row, clip.right - clip.left, { .codepoint = codepoint, .color = color });
 		}
 	}
 
-	void DrawGroup(int x, int y, const Group& group, bool override_color = false, const unsigned char& color_to_override = 0xbf) {
-		for (int i = 0; i < group.codepoints.size(); ++i) {
-			DrawTile(x + group.offset_x + i % group.width, y + group.offset_y + i / group.width, group.codepoints[i], override_color ? color_to_override : group.colors[i]);
+	// Tiles take the group's own layers unless override_layer is set.
+	template <int W, int H>
+	void DrawGroup(int x, int y, const Group<W, H>& group, bool override_layer = false, Layer layer_to_override = LAYER_DEFAULT) {
+		const int left = x + group.offset_x, top = y + group.offset_y;
+		const Clip clip = ClipRect(left, top, W, H);
+		if (clip.Empty()) return;
+		for (int i = 0; i < group.span_count; ++i) {
+			const Span& span = group.spans[i];
+			const int row = top + span.row;
+			if (row < clip.top || row >= clip.bottom) continue;
+			const int begin = left + span.start;
+			const int clipped_begin = std::max(begin, clip.left), clipped_end = std::min(begin + span.length, clip.right);
+			if (clipped_begin >= clipped_end) continue;
+
+			const int data = span.data + clipped_begin - begin;
+			BlitRow(clipped_begin, row, clipped_end - clipped_begin, {
+				.codepoints = &group.span_codepoints[data],
+				.colors = &group.span_colors[data],
+				.layers = override_layer ? nullptr : &group.span_layers[data],
+				.layer = layer_to_override,
+			});
 		}
 	}
 
@@ -192,50 +497,187 @@ struct Screen {
 		DrawTile(WIDTH - 1, 0, tr, color);
 		DrawTile(0, HEIGHT - 1, bl, color);
 		DrawTile(WIDTH - 1, HEIGHT - 1, br, color);
-		for (int i = 1; i < WIDTH - 1; ++i) {
-			DrawTile(i, 0, ht, color);
-			DrawTile(i, HEIGHT - 1, ht, color);
+		FillRect(1, 0, WIDTH - 2, 1, ht, color);
+		FillRect(1, HEIGHT - 1, WIDTH - 2, 1, ht, color);
+		FillRect(0, 1, 1, HEIGHT - 2, vt, color);
+		FillRect(WIDTH - 1, 1, 1, HEIGHT - 2, vt, color);
+	}
+
+	void DrawRun(const char* text, const TextRun& run, int x, int y, unsigned char color) {
+		const Clip clip = ClipRect(x, y + run.line, run.length, 1);
+		if (clip.Empty()) return;
+		BlitRow(clip.left, clip.top, clip.right - clip.left, { .codepoints = reinterpret_cast<const unsigned char*>(text) + run.offset + (clip.left - x), .color = color });
+	}
+
+	// For text that changes between draws, e.g. formatted into a reused buffer.
+	void DrawText(const char* text, int x, int y, unsigned char color) {
+		for (int line = 0, offset = 0;; ++line) {
+			int length = 0;
+			while (text[offset + length] != '\0' && text[offset + length] != '\n') ++length;
+			DrawRun(text, { line, offset, length }, x, y, color);
+			if (text[offset + length] == '\0') break;
+			offset += length + 1;
+		}
+	}
+
+	// For text that never changes at that address; laid out once.
+	void DrawStaticText(const char* text, int x, int y, unsigned char color) {
+		const TextLayoutCache::Layout* layout = text_layouts.Get(text);
+		if (layout == nullptr) {
+			DrawText(text, x, y, color);
+			return;
 		}
-		for (int i = 1; i < HEIGHT - 1; ++i) {
-			DrawTile(0, i, vt, color);
-			DrawTile(WIDTH - 1, i, vt, color);
+		for (int i = 0; i < layout->run_count; ++i) {
+			DrawRun(text, text_layouts.runs[layout->first_run + i], x, y, color);
 		}
 	}
 
-	void DrawText(const char* text, int x, int y, unsigned char color) {
-		int textOffsetX = 0, textOffsetY = 0;
-		for (int i = 0; i < TextLength(text); ++i) {
-			if (text[i] == '\n') {
-				textOffsetX = 0;
-				++textOffsetY;
-			}
-			else {
-				DrawTile(x + textOffsetX, y + textOffsetY, text[i], color);
-				++textOffsetX;
-			}
+	// Left-aligned when width is 0, otherwise right-aligned in width cells like FormatInt.
+	void DrawNumber(long long value, int x, int y, unsigned char color, int width = 0) {
+		constexpr int DIGITS = 20;
+		char digits[DIGITS];
+		FormatInt(digits, value, DIGITS);
+		int begin = DIGITS - std::min(width, DIGITS);
+		if (width == 0) {
+			begin = 0;
+			while (begin < DIGITS - 1 && digits[begin] == ' ') ++begin;
 		}
+		DrawRun(digits + begin, { 0, 0, DIGITS - begin }, x, y, color);
 	}
 
 	void ClearScreen() {
 		codepoints.fill(0x20);
 		colors.fill(0x00);
+		layers.fill(LAYER_DEFAULT);
+		++edits;
+		ResetRemaps();
+	}
+
+	void ResetRemaps() {
+		layer_remaps.fill(IDENTITY_REMAP);
+		screen_remap = IDENTITY_REMAP;
+	}
+
+	// Remaps are not part of a snapshot; set them again after restoring.
+	void Save(Snapshot& snapshot) {
+		snapshot.codepoints = codepoints;
+		snapshot.colors = colors;
+		snapshot.layers = layers;
+		snapshot.saved = true;
+		restored = &snapshot;
+		restored_edits = edits;
+	}
+
+	// Same as ClearScreen and redrawing the snapshot; free when the planes are untouched since.
+	void Restore(const Snapshot& snapshot) {
+		ResetRemaps();
+		if (restored == &snapshot && restored_edits == edits) return;
+		codepoints = snapshot.codepoints;
+		colors = snapshot.colors;
+		layers = snapshot.layers;
+		restored = &snapshot;
+		restored_edits = ++edits;
+	}
+
+	// Folds screen_remap into every layer's remap instead of touching tiles.
+	void ResolveRemaps(std::array<PalletteRemap, LAYER_COUNT>& resolved) const {
+		for (size_t layer = 0; layer < LAYER_COUNT; ++layer) {
+			for (size_t color = 0; color < 256; ++color) resolved[layer][color] = screen_remap[layer_remaps[layer][color]];
+		}
+	}
+
+	// Snapshots the planes with every remap applied; skipped when nothing changed.
+	void Resolve(Frame& frame) {
+		PROFILE_ZONE("Screen::Resolve");
+		std::array<PalletteRemap, LAYER_COUNT> resolved;
+		ResolveRemaps(resolved);
+		if (edits != resolved_edits || resolved != resolved_remaps) {
+			resolved_edits = edits;
+			resolved_remaps = resolved;
+			++revision;
+		}
+		if (frame.revision == revision) return;
+		frame.codepoints = codepoints;
+		for (size_t i = 0; i < TOTAL_TILES; ++i) frame.colors[i] = resolved[layers[i]][colors[i]];
+		frame.revision = revision;
 	}
 
-	void DrawScreen() const {
-		for (int i = 0; i < TOTAL_TILES; ++i) {
-			DrawTexturePro(cp437_8x8, SourceRect(codepoints.at(i)), DestRect(i), { 0, 0 }, 0, PALLETTE[colors.at(i)]);
+	void Present(const Frame& frame) const {
+		PROFILE_ZONE("Screen::Present");
+		const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		if (last_draw_screen.time_since_epoch().count() != 0) {
+			metrics.frame_time.Observe(std::chrono::duration_cast<std::chrono::nanoseconds>(begin - last_draw_screen).count());
+		}
+		last_draw_screen = begin;
+		if (!windowed) {
+			terminal.Present(frame.codepoints.data(), frame.colors.data());
+		}
+		else {
+			// the render target keeps the last picture, so an unchanged frame is only blitted again
+			if (frame.revision != presented_revision) {
+				BeginTextureMode(target);
+				ClearBackground(BLACK);
+				DrawTiles(frame);
+				EndTextureMode();
+			}
+			// render textures are stored bottom up, hence the negative source height
+			DrawTexturePro(target.texture, { 0, 0, WIDTH * FONT_SIZE, -(HEIGHT * FONT_SIZE) }, LetterboxRect(), { 0, 0 }, 0, WHITE);
+		}
+		presented_revision = frame.revision;
+		idle_frames = 0;
+		metrics.draw_screen_time.Observe(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+		metrics.frames.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// True when the screen already shows frame, so presenting it can be skipped.
+	bool Idle(const Frame& frame) const {
+		if (frame.revision != presented_revision) return false;
+		if (windowed ? IsWindowResized() || idle_frames + 1 >= IDLE_REFRESH_FRAMES : terminal.Resized()) return false;
+		++idle_frames;
+		last_draw_screen = {};
+		metrics.idle_frames.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void DrawTiles(const Frame& frame) const {
+		if (use_tilemap_shader) {
+			for (size_t i = 0; i < TOTAL_TILES; ++i) {
+				tile_texels[2 * i] = frame.codepoints[i];
+				tile_texels[2 * i + 1] = frame.colors[i];
+			}
+			UpdateTexture(tile_texture, tile_texels.data());
+			BeginShaderMode(tilemap_shader);
+			SetShaderValueTexture(tilemap_shader, font_location, cp437_8x8);
+			SetShaderValueTexture(tilemap_shader, pallette_location, pallette_texture);
+			DrawTexturePro(tile_texture, { 0, 0, WIDTH, HEIGHT }, { 0, 0, WIDTH * FONT_SIZE, HEIGHT * FONT_SIZE }, { 0, 0 }, 0, WHITE);
+			EndShaderMode();
+		}
+		else {
+			for (size_t i = 0; i < TOTAL_TILES; ++i) {
+				DrawTexturePro(cp437_8x8, SourceRect(frame.codepoints[i]), DestRect(i), { 0, 0 }, 0, PALLETTE[frame.colors[i]]);
+			}
 		}
 	}
 
+	// Largest whole multiple of the native size that fits the window, centered; never below 1x.
+	static Rectangle LetterboxRect() {
+		constexpr int NATIVE_WIDTH = static_cast<int>(WIDTH * FONT_SIZE), NATIVE_HEIGHT = static_cast<int>(HEIGHT * FONT_SIZE);
+		const int scale = std::max(1, std::min(GetScreenWidth() / NATIVE_WIDTH, GetScreenHeight() / NATIVE_HEIGHT));
+		const int width = NATIVE_WIDTH * scale, height = NATIVE_HEIGHT * scale;
+		return { static_cast<float>((GetScreenWidth() - width) / 2), static_cast<float>((GetScreenHeight() - height) / 2), static_cast<float>(width), static_cast<float>(height) };
+	}
+
 	static constexpr Rectangle SourceRect(unsigned char codepoint) {
 		return { static_cast<float>(8 * (codepoint % 16)), static_cast<float>(8 * (codepoint / 16)), 8, 8 };
 	}
 
-	static constexpr Rectangle DestRect(int tile_index) {
+	static constexpr Rectangle DestRect(size_t tile_index) {
 		return { FONT_SIZE * (tile_index % WIDTH), FONT_SIZE * (tile_index / WIDTH), FONT_SIZE, FONT_SIZE };
 	}
 };
 
+using Screen = TileScreen<WIDTH, HEIGHT>;
+
 struct Bullet {
 	float pos_x, pos_y, angle, speed, accel, maxspeed;
 	bool capped;
@@ -263,6 +705,53 @@ struct Bullet {
 	int GetY() const { return static_cast<int>(pos_y + 0.5f); }
 };
 
+// Recycles list nodes so bullets stop hitting the heap once the pool has grown to the busiest wave.
+inline std::pmr::unsynchronized_pool_resource bullet_pool;
+
+enum class GameTimer : uint8_t
+{
+	PLAYER_SHOT_READY,
+	PLAYER_IFRAME_END,
+	BOSS_WING_SHOT_READY,
+	BOSS_BODY_COVER_SHOT_READY,
+	BOSS_FINAL_SHOT_READY,
+	BOSS_FLASH_BODY_BASE_END,
+	BOSS_FLASH_BODY_COVER_END,
+	BOSS_FLASH_LEFT_WING_BASE_END,
+	BOSS_FLASH_LEFT_WING_COVER_END,
+	BOSS_FLASH_RIGHT_WING_BASE_END,
+	BOSS_FLASH_RIGHT_WING_COVER_END
+};
+
+using Timers = TimerWheel<GameTimer>;
+
+// Composited boss sprites keyed by visible parts; each part has its own layer, so flashes are remaps.
+struct BossSpriteCache {
+	static constexpr int SPRITE_WIDTH = 46, SPRITE_HEIGHT = 15;
+	static constexpr size_t ENTRIES = 4;
+	static constexpr uint16_t EMPTY = 0xffff;
+
+	using Sprite = Group<SPRITE_WIDTH, SPRITE_HEIGHT>;
+
+	std::array<Sprite, ENTRIES> sprites{};
+	std::array<uint16_t, ENTRIES> keys{ EMPTY, EMPTY, EMPTY, EMPTY };
+	size_t next = 0;
+
+	template <typename F>
+	const Sprite& Get(uint16_t key, F compose) {
+		for (size_t i = 0; i < ENTRIES; ++i) {
+			if (keys[i] == key) return sprites[i];
+		}
+		Sprite& sprite = sprites[next];
+		keys[next] = key;
+		next = (next + 1) % ENTRIES;
+		sprite.cells.fill({ 0x00, 0x00, LAYER_DEFAULT });
+		compose(sprite);
+		EncodeSpans(sprite);
+		return sprite;
+	}
+};
+
 struct Boss {
 	static constexpr int TOTAL_HEALTH = 1200;
 	static constexpr int BODY_COVER_HEALTH = 200;
@@ -273,7 +762,8 @@ struct Boss {
 	float pos_x, pos_y, vel_x, vel_y, acc_x, acc_y;
 
 	int total_health = TOTAL_HEALTH, body_cover_health = BODY_COVER_HEALTH, left_wing_health = WING_HEALTH, right_wing_health = WING_HEALTH;
-	int flash_body_base_cd = 0, flash_body_cover_cd = 0, flash_left_wing_base_cd = 0, flash_left_wing_cover_cd = 0, flash_right_wing_base_cd = 0, flash_right_wing_cover_cd = 0;
+	bool flash_body_base = false, flash_body_cover = false, flash_left_wing_base = false, flash_left_wing_cover = false, flash_right_wing_base = false, flash_right_wing_cover = false;
+	Timers::Handle flash_body_base_timer, flash_body_cover_timer, flash_left_wing_base_timer, flash_left_wing_cover_timer, flash_right_wing_base_timer, flash_right_wing_cover_timer;
 
 	enum class State
 	{
@@ -283,129 +773,179 @@ struct Boss {
 		FINAL_SHOOTING
 	};
 	State state = State::ENTERING;
+	Script behaviour;
+	Signal parts_destroyed;
+	// shared by every fight, since the sprites depend only on which parts are left
+	inline static BossSpriteCache sprite_cache;
 
-	int state_cd = FRAME_PER_SECOND;
-	int wing_shot_cd = FRAME_PER_SECOND + 30;
-	int body_cover_shot_cd = FRAME_PER_SECOND;
-	int final_state_shot_cd = 0;
+	Boss(float pos_x = WIDTH / 2 - 23, float pos_y = 0, float vel_x = 0, float vel_y = 0.30f, float acc_x = 0, float acc_y = -0.005f) :
+		pos_x(pos_x),
+		pos_y(pos_y),
+		vel_x(vel_x),
+		vel_y(vel_y),
+		acc_x(acc_x),
+		acc_y(acc_y)
+	{}
 
-	void Update() {
-		vel_x += acc_x;
-		vel_y += acc_y;
+	static constexpr int SWAY_TICKS = 200;
+	static constexpr int FINAL_MOVE_TICKS = FRAME_PER_SECOND;
 
-		pos_x += vel_x;
-		pos_y += vel_y;
+	bool wing_shot_ready = false;
+	bool body_cover_shot_ready = false;
+	bool final_state_shot_ready = true;
 
-		if (left_wing_health <= 0 && right_wing_health <= 0 && body_cover_health <= 0 && state != State::FINAL_INTO_POSITION && state != State::FINAL_SHOOTING) {
-			state = State::FINAL_INTO_POSITION;
-			state_cd = static_cast<float>(FRAME_PER_SECOND);
-			vel_x = 2 * (static_cast<float>(WIDTH) / 2 - 23 - pos_x) / state_cd;
-			vel_y = 2 * (static_cast<float>(HEIGHT) / 2 - 4 - pos_y) / state_cd;
-			acc_x = -vel_x / state_cd;
-			acc_y = -vel_y / state_cd;
-		}
-
-		if (state_cd <= 0) {
-			if (state == State::ENTERING || state == State::RIGHT) {
-				state = State::LEFT;
-				vel_x = -0.20;
-				state_cd = 200;
-				acc_x = -2 * vel_x / state_cd;
-				vel_y = 0;
-				acc_y = 0;
-			}
-			else if (state == State::LEFT) {
-				state = State::RIGHT;
-				vel_x = 0.20;
-				state_cd = 200;
-				acc_x = -2 * vel_x / state_cd;
-				vel_y = 0;
-				acc_y = 0;
-			}
-			else if (state == State::FINAL_INTO_POSITION) {
-				state = State::FINAL_SHOOTING;
-				vel_x = 0;
+	enum Emitter : uint16_t
+	{
+		LEFT_WING_EMITTER,
+		RIGHT_WING_EMITTER,
+		BODY_COVER_EMITTER,
+		FINAL_EMITTER
+	};
+	uint64_t seed = 0;
+	uint32_t tick = 0;
+
+	void Start(Timers& timers) {
+		timers.After(FRAME_PER_SECOND + 30, GameTimer::BOSS_WING_SHOT_READY);
+		timers.After(FRAME_PER_SECOND, GameTimer::BOSS_BODY_COVER_SHOT_READY);
+	}
+
+	void OnTimer(GameTimer timer) {
+		switch (timer) {
+		case GameTimer::BOSS_WING_SHOT_READY: wing_shot_ready = true; break;
+		case GameTimer::BOSS_BODY_COVER_SHOT_READY: body_cover_shot_ready = true; break;
+		case GameTimer::BOSS_FINAL_SHOT_READY: final_state_shot_ready = true; break;
+		case GameTimer::BOSS_FLASH_BODY_BASE_END: flash_body_base = false; break;
+		case GameTimer::BOSS_FLASH_BODY_COVER_END: flash_body_cover = false; break;
+		case GameTimer::BOSS_FLASH_LEFT_WING_BASE_END: flash_left_wing_base = false; break;
+		case GameTimer::BOSS_FLASH_LEFT_WING_COVER_END: flash_left_wing_cover = false; break;
+		case GameTimer::BOSS_FLASH_RIGHT_WING_BASE_END: flash_right_wing_base = false; break;
+		case GameTimer::BOSS_FLASH_RIGHT_WING_COVER_END: flash_right_wing_cover = false; break;
+		default: break;
+		}
+	}
+
+	// Movement phases; each phase sets a velocity and waits, and destroying every part cuts the sway short.
+	Script Behaviour(ScriptScheduler& scripts) {
+		// + 1 since the script starts partway through tick 0
+		if (!co_await scripts.Ticks(FRAME_PER_SECOND + 1, &parts_destroyed)) {
+			for (float direction = -1;; direction = -direction) {
+				state = direction < 0 ? State::LEFT : State::RIGHT;
+				vel_x = 0.20f * direction;
+				acc_x = -2 * vel_x / SWAY_TICKS;
 				vel_y = 0;
-				acc_x = 0;
 				acc_y = 0;
+				if (co_await scripts.Ticks(SWAY_TICKS, &parts_destroyed)) break;
 			}
 		}
 
-		if (wing_shot_cd <= 0) {
-			wing_shot_cd = 30;
+		state = State::FINAL_INTO_POSITION;
+		vel_x = 2 * (static_cast<float>(WIDTH) / 2 - 23 - pos_x) / FINAL_MOVE_TICKS;
+		vel_y = 2 * (static_cast<float>(HEIGHT) / 2 - 4 - pos_y) / FINAL_MOVE_TICKS;
+		acc_x = -vel_x / FINAL_MOVE_TICKS;
+		acc_y = -vel_y / FINAL_MOVE_TICKS;
+		co_await scripts.Ticks(FINAL_MOVE_TICKS);
+
+		state = State::FINAL_SHOOTING;
+		vel_x = 0;
+		vel_y = 0;
+		acc_x = 0;
+		acc_y = 0;
+	}
+
+	void CheckPartsDestroyed() {
+		if (left_wing_health <= 0 && right_wing_health <= 0 && body_cover_health <= 0) {
+			parts_destroyed.Raise();
+		}
+	}
+
+	void Flash(bool& flash, Timers::Handle& timer, GameTimer end, Timers& timers) {
+		flash = true;
+		timers.Reschedule(timer, timers.now + 2, end);
+	}
+
+	void Update(Timers& timers) {
+		vel_x += acc_x;
+		vel_y += acc_y;
+
+		pos_x += vel_x;
+		pos_y += vel_y;
+
+		if (wing_shot_ready) {
+			wing_shot_ready = false;
+			timers.After(30, GameTimer::BOSS_WING_SHOT_READY);
 		}
 
-		if (body_cover_shot_cd <= 0) {
-			body_cover_shot_cd = 80;
+		if (body_cover_shot_ready) {
+			body_cover_shot_ready = false;
+			timers.After(80, GameTimer::BOSS_BODY_COVER_SHOT_READY);
 		}
 
-		if (final_state_shot_cd <= 0) {
-			final_state_shot_cd = 10;
+		if (final_state_shot_ready) {
+			final_state_shot_ready = false;
+			timers.After(10, GameTimer::BOSS_FINAL_SHOT_READY);
 		}
 
-		--state_cd;
-		--wing_shot_cd;
-		--body_cover_shot_cd;
-		--final_state_shot_cd;
-		--flash_body_base_cd;
-		--flash_body_cover_cd;
-		--flash_left_wing_base_cd;
-		--flash_left_wing_cover_cd;
-		--flash_right_wing_base_cd;
-		--flash_right_wing_cover_cd;
+		++tick;
 	}
 
-	std::vector<Bullet> Shoot(int player_x, int player_y) const {
-		std::vector<Bullet> to_shoot;
-		if (wing_shot_cd <= 0) {
-			if (left_wing_health > WING_HEALTH - WING_COVER_HEALTH) {
-				for (float i = 0; i < 3; ++i) {
-					to_shoot.emplace_back(pos_x + 2.f, pos_y + 9, -PI / 2.f - PI / 6.f, 0.4f + i * 0.05f);
-					to_shoot.emplace_back(pos_x + 7.f, pos_y + 9, -PI / 2.f, 0.4f + i * 0.05f);
-					to_shoot.emplace_back(pos_x + 12.f, pos_y + 9, -PI / 2.f + PI / 6.f, 0.4f + i * 0.05f);
-				}
+	void ShootWing(std::pmr::vector<Bullet>& to_shoot, float origin_x, int health, Emitter emitter) const {
+		const RandomStream rng(seed, tick, emitter);
+		if (health > WING_HEALTH - WING_COVER_HEALTH) {
+			float spread[9], speed[9];
+			rng.Fill(spread, 9, -PI / 48.f, PI / 48.f);
+			rng.Fill(speed, 9, -0.03f, 0.03f, 9);
+			for (int i = 0; i < 3; ++i) {
+				to_shoot.emplace_back(origin_x - 5.f, pos_y + 9, -PI / 2.f - PI / 6.f + spread[3 * i], 0.4f + i * 0.05f + speed[3 * i]);
+				to_shoot.emplace_back(origin_x, pos_y + 9, -PI / 2.f + spread[3 * i + 1], 0.4f + i * 0.05f + speed[3 * i + 1]);
+				to_shoot.emplace_back(origin_x + 5.f, pos_y + 9, -PI / 2.f + PI / 6.f + spread[3 * i + 2], 0.4f + i * 0.05f + speed[3 * i + 2]);
 			}
-			else if (left_wing_health > 0) {
-				for (float i = 1; i < 7; i += 2) {
-					to_shoot.emplace_back(pos_x + 7.f, pos_y + 9, -i * PI / 7, 0.3f);
-					to_shoot.emplace_back(pos_x + 7.f, pos_y + 9, -i * PI / 7 - PI / 21, 0.3f);
-					to_shoot.emplace_back(pos_x + 7.f, pos_y + 9, -i * PI / 7 - 2 * PI / 21, 0.3f);
-					to_shoot.emplace_back(pos_x + 7.f, pos_y + 9, -i * PI / 7 - PI / 7, 0.3f);
-				}
-			}
-			if (right_wing_health > WING_HEALTH - WING_COVER_HEALTH) {
-				for (float i = 0; i < 3; ++i) {
-					to_shoot.emplace_back(pos_x + 32.f, pos_y + 9, -PI / 2.f - PI / 6.f, 0.4f + i * 0.05f);
-					to_shoot.emplace_back(pos_x + 37.f, pos_y + 9, -PI / 2.f, 0.4f + i * 0.05f);
-					to_shoot.emplace_back(pos_x + 42.f, pos_y + 9, -PI / 2.f + PI / 6.f, 0.4f + i * 0.05f);
-				}
-			}
-			else if (right_wing_health > 0) {
-				for (float i = 1; i < 7; i += 2) {
-					to_shoot.emplace_back(pos_x + 37.f, pos_y + 9, -i * PI / 7, 0.3f);
-					to_shoot.emplace_back(pos_x + 37.f, pos_y + 9, -i * PI / 7 - PI / 21, 0.3f);
-					to_shoot.emplace_back(pos_x + 37.f, pos_y + 9, -i * PI / 7 - 2 * PI / 21, 0.3f);
-					to_shoot.emplace_back(pos_x + 37.f, pos_y + 9, -i * PI / 7 - PI / 7, 0.3f);
-				}
+		}
+		else if (health > 0) {
+			// alternate between the odd and even sevenths so the fan cannot be memorized
+			const float first = static_cast<float>(1 + rng.Pick(18, 2));
+			const float rotation = rng.Range(19, -PI / 42.f, PI / 42.f);
+			for (float i = first; i < 7; i += 2) {
+				to_shoot.emplace_back(origin_x, pos_y + 9, -i * PI / 7 + rotation, 0.3f);
+				to_shoot.emplace_back(origin_x, pos_y + 9, -i * PI / 7 - PI / 21 + rotation, 0.3f);
+				to_shoot.emplace_back(origin_x, pos_y + 9, -i * PI / 7 - 2 * PI / 21 + rotation, 0.3f);
+				to_shoot.emplace_back(origin_x, pos_y + 9, -i * PI / 7 - PI / 7 + rotation, 0.3f);
 			}
 		}
-		if (body_cover_health > 0 && body_cover_shot_cd <= 0) {
-			to_shoot.emplace_back(pos_x + 23.f, pos_y + 16.f + 1, atan2f(pos_y + 16.f - static_cast<float>(player_y), static_cast<float>(player_x) - (pos_x + 23.f)), 0.4f);
-			to_shoot.emplace_back(pos_x + 23.f, pos_y + 16.f - 1, atan2f(pos_y + 16.f - static_cast<float>(player_y), static_cast<float>(player_x) - (pos_x + 23.f)), 0.4f);
-			to_shoot.emplace_back(pos_x + 23.f + 1, pos_y + 16.f, atan2f(pos_y + 16.f - static_cast<float>(player_y), static_cast<float>(player_x) - (pos_x + 23.f)), 0.4f);
-			to_shoot.emplace_back(pos_x + 23.f - 1, pos_y + 16.f, atan2f(pos_y + 16.f - static_cast<float>(player_y), static_cast<float>(player_x) - (pos_x + 23.f)), 0.4f);
+	}
+
+	std::pmr::vector<Bullet> Shoot(int player_x, int player_y, std::pmr::memory_resource* resource) const {
+		PROFILE_ZONE("Boss::Shoot");
+		ALLOC_SCOPE(BOSS_SHOOT);
+		std::pmr::vector<Bullet> to_shoot(resource);
+		if (wing_shot_ready) {
+			ShootWing(to_shoot, pos_x + 7.f, left_wing_health, LEFT_WING_EMITTER);
+			ShootWing(to_shoot, pos_x + 37.f, right_wing_health, RIGHT_WING_EMITTER);
+		}
+		if (body_cover_health > 0 && body_cover_shot_ready) {
+			const RandomStream rng(seed, tick, BODY_COVER_EMITTER);
+			float speed[4];
+			rng.Fill(speed, 4, 0.35f, 0.45f);
+			const float aim = atan2f(pos_y + 16.f - static_cast<float>(player_y), static_cast<float>(player_x) - (pos_x + 23.f));
+			to_shoot.emplace_back(pos_x + 23.f, pos_y + 16.f + 1, aim, speed[0]);
+			to_shoot.emplace_back(pos_x + 23.f, pos_y + 16.f - 1, aim, speed[1]);
+			to_shoot.emplace_back(pos_x + 23.f + 1, pos_y + 16.f, aim, speed[2]);
+			to_shoot.emplace_back(pos_x + 23.f - 1, pos_y + 16.f, aim, speed[3]);
 		}
-		if (state == State::FINAL_SHOOTING && final_state_shot_cd <= 0) {
+		if (state == State::FINAL_SHOOTING && final_state_shot_ready) {
 			constexpr float STAR_SHOTS = 16;
 			constexpr float ANGLE_PIECE = 2 * PI / STAR_SHOTS;
+			const RandomStream rng(seed, tick, FINAL_EMITTER);
+			const float aim = atan2f(pos_y + 4.f - static_cast<float>(player_y), static_cast<float>(player_x) - (pos_x + 23.f)) + rng.Range(0, -ANGLE_PIECE / 4, ANGLE_PIECE / 4);
 			for (float i = 0; i < STAR_SHOTS; ++i) {
-				to_shoot.emplace_back(pos_x + 23.f, pos_y + 4.f, atan2f(pos_y + 4.f - static_cast<float>(player_y), static_cast<float>(player_x) - (pos_x + 23.f)) + i * ANGLE_PIECE, 0.5f);
+				to_shoot.emplace_back(pos_x + 23.f, pos_y + 4.f, aim + i * ANGLE_PIECE, 0.5f);
 			}
 		}
 		return to_shoot;
 	}
 
-	bool CheckCollision(int x, int y) {
+	bool CheckCollision(int x, int y, Timers& timers) {
+		PROFILE_ZONE("Boss::CheckCollision");
+		++frame_stats.collision_tests;
 		if (state == State::ENTERING) return false;
 
 		int rel_x = x - static_cast<int>(pos_x), rel_y = y - static_cast<int>(pos_y);
@@ -413,11 +953,12 @@ struct Boss {
 		if (left_wing_health > 0 && rel_x >= 0 && rel_x < 16 && rel_y >= 1 && rel_y < 7) {
 			--left_wing_health;
 			if (left_wing_health > WING_HEALTH - WING_COVER_HEALTH)
-				flash_left_wing_cover_cd = 2;
+				Flash(flash_left_wing_cover, flash_left_wing_cover_timer, GameTimer::BOSS_FLASH_LEFT_WING_COVER_END, timers);
 			else
-				flash_left_wing_base_cd = 2;
+				Flash(flash_left_wing_base, flash_left_wing_base_timer, GameTimer::BOSS_FLASH_LEFT_WING_BASE_END, timers);
 			if (left_wing_health <= 0) {
 				total_health -= WING_HEALTH;
+				CheckPartsDestroyed();
 			}
 			return true;
 		}
@@ -425,132 +966,237 @@ struct Boss {
 		if (right_wing_health > 0 && rel_x >= 30 && rel_x < 46 && rel_y >= 1 && rel_y < 7) {
 			--right_wing_health;
 			if (right_wing_health > WING_HEALTH - WING_COVER_HEALTH)
-				flash_right_wing_cover_cd = 2;
+				Flash(flash_right_wing_cover, flash_right_wing_cover_timer, GameTimer::BOSS_FLASH_RIGHT_WING_COVER_END, timers);
 			else
-				flash_right_wing_base_cd = 2;
+				Flash(flash_right_wing_base, flash_right_wing_base_timer, GameTimer::BOSS_FLASH_RIGHT_WING_BASE_END, timers);
 			if (right_wing_health <= 0) {
 				total_health -= WING_HEALTH;
+				CheckPartsDestroyed();
 			}
 			return true;
 		}
 
 		if (body_cover_health > 0 && rel_x >= 19 && rel_x < 27 && rel_y >= 8 && rel_y < 14) {
 			--body_cover_health;
-			flash_body_cover_cd = 2;
+			Flash(flash_body_cover, flash_body_cover_timer, GameTimer::BOSS_FLASH_BODY_COVER_END, timers);
 			if (body_cover_health <= 0) {
 				total_health -= BODY_COVER_HEALTH;
+				CheckPartsDestroyed();
 			}
 			return true;
 		}
 		if (total_health > 0 && rel_x >= 19 && rel_x < 27 && rel_y >= 0 && rel_y < 8) {
 			--total_health;
-			flash_body_base_cd = 2;
+			Flash(flash_body_base, flash_body_base_timer, GameTimer::BOSS_FLASH_BODY_BASE_END, timers);
 			return true;
 		}
 		return false;
 	}
 
 	void Draw(Screen& sc) {
-		sc.DrawGroup(pos_x + 16, pos_y, BOSS_BODY_BASE, flash_body_base_cd > 0);
-		if (left_wing_health > 0) {
-			sc.DrawGroup(static_cast<int>(pos_x), static_cast<int>(pos_y), BOSS_WING_BASE, flash_left_wing_base_cd > 0);
-		}
-		if (left_wing_health > WING_HEALTH - WING_COVER_HEALTH) {
-			sc.DrawGroup(static_cast<int>(pos_x), static_cast<int>(pos_y), BOSS_WING_COVER, flash_left_wing_cover_cd > 0);
-		}
-		if (right_wing_health > 0) {
-			sc.DrawGroup(static_cast<int>(pos_x) + 30, static_cast<int>(pos_y), BOSS_WING_BASE, flash_right_wing_base_cd > 0);
-		}
-		if (right_wing_health > WING_HEALTH - WING_COVER_HEALTH) {
-			sc.DrawGroup(static_cast<int>(pos_x) + 30, static_cast<int>(pos_y), BOSS_WING_COVER, flash_right_wing_cover_cd > 0);
-		}
-		if (body_cover_health > 0) {
-			sc.DrawGroup(static_cast<int>(pos_x) + 16, static_cast<int>(pos_y), BOSS_BODY_COVER, flash_body_cover_cd > 0);
-		}
+		const bool left_wing = left_wing_health > 0, left_wing_cover = left_wing_health > WING_HEALTH - WING_COVER_HEALTH;
+		const bool right_wing = right_wing_health > 0, right_wing_cover = right_wing_health > WING_HEALTH - WING_COVER_HEALTH;
+		const bool body_cover = body_cover_health > 0;
+		const uint16_t key = left_wing | left_wing_cover << 1 | right_wing << 2 | right_wing_cover << 3 | body_cover << 4;
+
+		const BossSpriteCache::Sprite& sprite = sprite_cache.Get(key, [&](BossSpriteCache::Sprite& sprite) {
+			ComposeGroup(sprite, 16, 0, BOSS_BODY_BASE, LAYER_BOSS_BODY_BASE);
+			if (left_wing) ComposeGroup(sprite, 0, 0, BOSS_WING_BASE, LAYER_BOSS_LEFT_WING_BASE);
+			if (left_wing_cover) ComposeGroup(sprite, 0, 0, BOSS_WING_COVER, LAYER_BOSS_LEFT_WING_COVER);
+			if (right_wing) ComposeGroup(sprite, 30, 0, BOSS_WING_BASE, LAYER_BOSS_RIGHT_WING_BASE);
+			if (right_wing_cover) ComposeGroup(sprite, 30, 0, BOSS_WING_COVER, LAYER_BOSS_RIGHT_WING_COVER);
+			if (body_cover) ComposeGroup(sprite, 16, 0, BOSS_BODY_COVER, LAYER_BOSS_BODY_COVER);
+		});
+		sc.DrawGroup(static_cast<int>(pos_x), static_cast<int>(pos_y), sprite);
+
+		if (flash_body_base) sc.layer_remaps[LAYER_BOSS_BODY_BASE] = FLASH_REMAP;
+		if (flash_body_cover) sc.layer_remaps[LAYER_BOSS_BODY_COVER] = FLASH_REMAP;
+		if (flash_left_wing_base) sc.layer_remaps[LAYER_BOSS_LEFT_WING_BASE] = FLASH_REMAP;
+		if (flash_left_wing_cover) sc.layer_remaps[LAYER_BOSS_LEFT_WING_COVER] = FLASH_REMAP;
+		if (flash_right_wing_base) sc.layer_remaps[LAYER_BOSS_RIGHT_WING_BASE] = FLASH_REMAP;
+		if (flash_right_wing_cover) sc.layer_remaps[LAYER_BOSS_RIGHT_WING_COVER] = FLASH_REMAP;
 	}
 };
 
 struct GameManager {
+	static constexpr size_t MAX_PLAYER_BULLETS = 256;
+	static constexpr size_t MAX_BOSS_BULLETS = 2048;
+	static constexpr int IFRAME_TICKS = 2 * FRAME_PER_SECOND;
+	static constexpr int DAMAGE_TINT_TICKS = 16;
+
 	int player_x = WIDTH / 2, player_y = HEIGHT - 10, player_lives = 3;
 
-	Boss boss{ WIDTH / 2 - 23, 0, 0, 0.30, 0, -0.005 };
+	ScriptScheduler scripts;
+	Boss boss;
 
-	std::list<Bullet> player_bullets;
-	std::list<Bullet> boss_bullets;
-	int shot_cd = 0;
-	int iframe_cd = 0;
+	std::pmr::list<Bullet> player_bullets{ &bullet_pool };
+	std::pmr::list<Bullet> boss_bullets{ &bullet_pool };
+	Timers timers;
+	bool shot_ready = true;
+	bool invulnerable = false;
+	uint64_t iframe_end = 0;
+
+	GameManager(uint64_t seed = 0) {
+		Reset(seed);
+		metrics.player_bullet_capacity.store(MAX_PLAYER_BULLETS, std::memory_order_relaxed);
+		metrics.boss_bullet_capacity.store(MAX_BOSS_BULLETS, std::memory_order_relaxed);
+	}
+
+	// Starts a new fight in place; wakeups are dropped before the old script frame.
+	void Reset(uint64_t seed) {
+		scripts.Reset();
+		boss = Boss();
+		boss.seed = seed;
+		player_x = WIDTH / 2;
+		player_y = HEIGHT - 10;
+		player_lives = 3;
+		player_bullets.clear();
+		boss_bullets.clear();
+		timers.Clear();
+		shot_ready = true;
+		invulnerable = false;
+		iframe_end = 0;
+		boss.Start(timers);
+	}
+
+	// Grows bullet_pool to full capacity up front, so later waves never reach the heap.
+	static void ReserveBullets() {
+		std::pmr::list<Bullet> reserve{ &bullet_pool };
+		for (size_t i = 0; i < MAX_PLAYER_BULLETS + MAX_BOSS_BULLETS; ++i) {
+			reserve.emplace_back(0.f, 0.f, 0.f, 0.f);
+		}
+	}
+
+	void OnTimer(GameTimer timer) {
+		switch (timer) {
+		case GameTimer::PLAYER_SHOT_READY: shot_ready = true; break;
+		case GameTimer::PLAYER_IFRAME_END: invulnerable = false; break;
+		default: boss.OnTimer(timer); break;
+		}
+	}
+
+	void Hit() {
+		--player_lives;
+		player_x = WIDTH / 2;
+		player_y = HEIGHT - 10;
+		invulnerable = true;
+		iframe_end = timers.now + IFRAME_TICKS;
+		timers.At(iframe_end, GameTimer::PLAYER_IFRAME_END);
+	}
+
+	// Transient containers come from resource, normally the frame arena.
+	void Update(std::pmr::memory_resource* resource) {
+		PROFILE_ZONE("GameManager::Update");
+		ALLOC_SCOPE(SIMULATION);
+		const std::chrono::steady_clock::time_point tick_begin = std::chrono::steady_clock::now();
+
+		// started here, not in Reset, since the script keeps pointers into this object
+		if (!boss.behaviour) {
+			boss.behaviour = boss.Behaviour(scripts);
+			scripts.Start(boss.behaviour);
+		}
 
-	void Update() {
 		int dir_x = 0, dir_y = 0;
-		if (IsKeyDown(KEY_UP)) --dir_y;
-		if (IsKeyDown(KEY_DOWN)) ++dir_y;
-		if (IsKeyDown(KEY_LEFT)) --dir_x;
-		if (IsKeyDown(KEY_RIGHT)) ++dir_x;
+		bool fire = false;
+		{
+			PROFILE_ZONE("Input");
+			if (KeyDown(KEY_UP)) --dir_y;
+			if (KeyDown(KEY_DOWN)) ++dir_y;
+			if (KeyDown(KEY_LEFT)) --dir_x;
+			if (KeyDown(KEY_RIGHT)) ++dir_x;
+			fire = KeyDown(KEY_C);
+		}
 
-		if (IsKeyDown(KEY_C) and shot_cd <= 0) {
+		if (fire and shot_ready and player_bullets.size() + 3 <= MAX_PLAYER_BULLETS) {
 			player_bullets.emplace_back(player_x - 1, player_y - 1, PI / 2, 1);
 			player_bullets.emplace_back(player_x, player_y - 2, PI / 2, 1);
 			player_bullets.emplace_back(player_x + 1, player_y - 1, PI / 2, 1);
-			shot_cd = 5;
+			shot_ready = false;
+			timers.After(5, GameTimer::PLAYER_SHOT_READY);
 		}
 
 		if (boss.total_health > 0) {
-			std::vector<Bullet> boss_bullets_to_spawn = boss.Shoot(player_x, player_y);
-			boss_bullets.insert(boss_bullets.end(), boss_bullets_to_spawn.begin(), boss_bullets_to_spawn.end());
+			std::pmr::vector<Bullet> boss_bullets_to_spawn = boss.Shoot(player_x, player_y, resource);
+			const size_t room = MAX_BOSS_BULLETS - std::min(MAX_BOSS_BULLETS, boss_bullets.size());
+			const size_t spawned = std::min(room, boss_bullets_to_spawn.size());
+			boss_bullets.insert(boss_bullets.end(), boss_bullets_to_spawn.begin(), boss_bullets_to_spawn.begin() + spawned);
+			if (spawned < boss_bullets_to_spawn.size()) {
+				metrics.dropped_spawns.fetch_add(boss_bullets_to_spawn.size() - spawned, std::memory_order_relaxed);
+			}
 		}
 
 		player_x = std::min(std::max(player_x + dir_x, 1), static_cast<int>(WIDTH - 2));
 		player_y = std::min(std::max(player_y + dir_y, 1), static_cast<int>(HEIGHT - 2));
 
-		if (boss.CheckCollision(player_x, player_y) && iframe_cd <= 0) {
-			--player_lives;
-			player_x = WIDTH / 2;
-			player_y = HEIGHT - 10;
-			iframe_cd = 2 * FRAME_PER_SECOND;
+		{
+			PERF_PHASE(COLLISION);
+			if (boss.CheckCollision(player_x, player_y, timers) && !invulnerable) {
+				Hit();
+			}
 		}
 
-		std::vector<std::list<Bullet>::iterator> player_bullets_to_remove;
-		for (auto it = player_bullets.begin(); it != player_bullets.end(); ++it) {
-			it->Update();
-			if (it->pos_x < 1 || it->pos_x > WIDTH - 2 || it->pos_y < 1 || it->pos_y > HEIGHT - 2) {
-				player_bullets_to_remove.push_back(it);
+		{
+			PROFILE_ZONE("PlayerBullets");
+			ALLOC_SCOPE(BULLETS);
+			std::pmr::vector<std::pmr::list<Bullet>::iterator> player_bullets_to_remove(resource);
+			for (auto it = player_bullets.begin(); it != player_bullets.end(); ++it) {
+				it->Update();
+				if (it->pos_x < 1 || it->pos_x > WIDTH - 2 || it->pos_y < 1 || it->pos_y > HEIGHT - 2) {
+					player_bullets_to_remove.push_back(it);
+				}
+				else if (boss.CheckCollision(it->pos_x, it->pos_y, timers)) {
+					player_bullets_to_remove.push_back(it);
+				}
 			}
-			else if (boss.CheckCollision(it->pos_x, it->pos_y)) {
-				player_bullets_to_remove.push_back(it);
+			for (const std::pmr::list<Bullet>::iterator& it : player_bullets_to_remove) {
+				player_bullets.erase(it);
 			}
 		}
-		for (const std::list<Bullet>::iterator& it : player_bullets_to_remove) {
-			player_bullets.erase(it);
-		}
 
-		std::vector<std::list<Bullet>::iterator> boss_bullets_to_remove;
-		for (auto it = boss_bullets.begin(); it != boss_bullets.end(); ++it) {
-			it->Update();
-			if (it->pos_x < 1 || it->pos_x > WIDTH - 2 || it->pos_y < 1 || it->pos_y > HEIGHT - 2) {
-				boss_bullets_to_remove.push_back(it);
-			}
-			else if (it->GetX() == player_x && it->GetY() == player_y) {
-				boss_bullets_to_remove.push_back(it);
-				if (iframe_cd <= 0) {
-					--player_lives;
-					player_x = WIDTH / 2;
-					player_y = HEIGHT - 10;
-					iframe_cd = 2 * FRAME_PER_SECOND;
+		{
+			PROFILE_ZONE("BossBullets");
+			ALLOC_SCOPE(BULLETS);
+			std::pmr::vector<std::pmr::list<Bullet>::iterator> boss_bullets_to_remove(resource);
+			for (auto it = boss_bullets.begin(); it != boss_bullets.end(); ++it) {
+				it->Update();
+				if (it->pos_x < 1 || it->pos_x > WIDTH - 2 || it->pos_y < 1 || it->pos_y > HEIGHT - 2) {
+					boss_bullets_to_remove.push_back(it);
+				}
+				else if (it->GetX() == player_x && it->GetY() == player_y) {
+					boss_bullets_to_remove.push_back(it);
+					if (!invulnerable) {
+						Hit();
+					}
 				}
 			}
+			for (const std::pmr::list<Bullet>::iterator& it : boss_bullets_to_remove) {
+				boss_bullets.erase(it);
+			}
 		}
-		for (const std::list<Bullet>::iterator& it : boss_bullets_to_remove) {
-			boss_bullets.erase(it);
-		}
 
-		boss.Update();
+		boss.Update(timers);
+
+		timers.Advance([this](GameTimer timer) { OnTimer(timer); });
+		scripts.Tick();
 
-		--shot_cd;
-		--iframe_cd;
+		metrics.player_bullets.store(player_bullets.size(), std::memory_order_relaxed);
+		metrics.boss_bullets.store(boss_bullets.size(), std::memory_order_relaxed);
+		metrics.ticks.fetch_add(1, std::memory_order_relaxed);
+		metrics.tick_time.Observe(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tick_begin).count());
 	}
 
 	void Draw(Screen& sc) {
-		sc.DrawGroup(player_x, player_y, PLAYER_GROUP, (iframe_cd / 8) % 2 == 1);
+		PROFILE_ZONE("GameManager::Draw");
+		ALLOC_SCOPE(DRAW);
+		sc.DrawGroup(player_x, player_y, PLAYER_GROUP, true, LAYER_PLAYER);
+		if (invulnerable && ((iframe_end - timers.now) / 8) % 2 == 1) {
+			sc.layer_remaps[LAYER_PLAYER] = FLASH_REMAP;
+		}
+		// red tint fading out over the first DAMAGE_TINT_TICKS of the i-frames
+		const uint64_t since_hit = timers.now + IFRAME_TICKS - iframe_end;
+		if (invulnerable && since_hit < DAMAGE_TINT_TICKS) {
+			sc.screen_remap = DAMAGE_TINT.steps[8 - since_hit * 8 / DAMAGE_TINT_TICKS];
+		}
 		for (const Bullet& player_bullet : player_bullets) {
 			sc.DrawTile(player_bullet.GetX(), player_bullet.GetY(), 0x13, 0x37);
 		}
@@ -560,26 +1206,126 @@ struct GameManager {
 		if (boss.total_health > 0)
 			boss.Draw(sc);
 		sc.DrawBorder(0xc9, 0xbb, 0xc8, 0xbc, 0xcd, 0xba, 0x9f);
-		sc.DrawText(" LIVES:  ", 3, HEIGHT - 1, 0xbf);
-		sc.DrawText(TextFormat("%d", player_lives), 10, HEIGHT - 1, 0x07);
+		sc.DrawStaticText(" LIVES:  ", 3, HEIGHT - 1, 0xbf);
+		sc.DrawNumber(player_lives, 10, HEIGHT - 1, 0x07);
 	}
 };
 
 int main()
 {
 	Scene current_scene = Scene::START_SCENE;
-	Screen sc("u tell me a Tung text-based this game jam");
-	GameManager g;
-	SetTargetFPS(FRAME_PER_SECOND);
-	while (!WindowShouldClose())
-	{
+
+	// TBGJ4_TERMINAL=1 (or 256 / truecolor to force the color mode) plays in the terminal, no window
+	const char* terminal_mode = getenv("TBGJ4_TERMINAL");
+	if (terminal_mode != nullptr && !terminal.Open(terminal_mode, WIDTH, HEIGHT, FRAME_PER_SECOND)) {
+		TraceLog(LOG_WARNING, "terminal backend unavailable; opening a window");
+	}
+
+	// static since the planes outgrow the stack on the large grids
+	static Screen sc("u tell me a Tung text-based this game jam");
+	// TBGJ4_SEED=<n> replays the bullet patterns of an earlier run
+	uint64_t seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	const char* seed_text = getenv("TBGJ4_SEED");
+	if (seed_text != nullptr) {
+		char* end = nullptr;
+		const unsigned long long value = strtoull(seed_text, &end, 0);
+		if (end == seed_text || *end != '\0') {
+			TraceLog(LOG_WARNING, "TBGJ4_SEED must be a number, got \"%s\"; using the clock", seed_text);
+		}
+		else {
+			seed = value;
+		}
+	}
+	TraceLog(LOG_INFO, "seed %llu", static_cast<unsigned long long>(seed));
+	GameManager::ReserveBullets();
+	// static for the same reason, and restarts reset it in place
+	static GameManager g(seed);
+	if (!terminal.active) {
+		window_pacer.Open(FRAME_PER_SECOND);
+	}
+
+	MetricsServer metrics_server;
+	const char* metrics_port = getenv("TBGJ4_METRICS_PORT");
+	uint16_t port = 9464;
+	if (metrics_port != nullptr) {
+		char* end = nullptr;
+		const unsigned long value = strtoul(metrics_port, &end, 10);
+		if (end == metrics_port || *end != '\0' || value < 1 || value > 65535) {
+			TraceLog(LOG_WARNING, "TBGJ4_METRICS_PORT must be a port from 1 to 65535, got \"%s\"; using %u", metrics_port, port);
+		}
+		else {
+			port = static_cast<uint16_t>(value);
+		}
+	}
+#ifdef TBGJ4_METRICS
+	if (!metrics_server.Start(port)) {
+		TraceLog(LOG_WARNING, "cannot serve metrics on 127.0.0.1:%u; not exporting", port);
+	}
+#else
+	metrics_server.Start(port);
+#endif
+
+	alloc_guard.Configure(getenv("TBGJ4_ASSERT_NO_ALLOC"));
+
+	const char* record_path = getenv("TBGJ4_RECORD");
+	if (record_path != nullptr && !recorder.Open(record_path, WIDTH, HEIGHT, FRAME_PER_SECOND, seed)) {
+		TraceLog(LOG_WARNING, "cannot open %s; not recording", record_path);
+	}
+
+	// TBGJ4_PIPELINE=1 simulates the next frame on a second thread while this one presents;
+	// TBGJ4_AFFINITY=<render cpu>,<simulation cpu> pins the two threads on Linux
+	const char* pipeline_mode = getenv("TBGJ4_PIPELINE");
+	bool pipelined = pipeline_mode != nullptr && pipeline_mode[0] == '1';
+	int render_cpu = -1, simulation_cpu = -1;
+	const char* affinity = getenv("TBGJ4_AFFINITY");
+	if (affinity != nullptr && sscanf(affinity, "%d,%d", &render_cpu, &simulation_cpu) != 2) {
+		TraceLog(LOG_WARNING, "TBGJ4_AFFINITY must be <render cpu>,<simulation cpu>");
+		render_cpu = simulation_cpu = -1;
+	}
+
+#ifdef TBGJ4_PERF_COUNTERS
+	// the counters follow the thread that opened them and phases are tracked in one shared state
+	if (pipelined) {
+		TraceLog(LOG_WARNING, "TBGJ4_PIPELINE ignored; perf counters need the single-threaded loop");
+		pipelined = false;
+	}
+	const char* perf_csv = getenv("TBGJ4_PERF_CSV");
+	if (!perf_counters.Open(perf_csv != nullptr ? perf_csv : "tbgj4_perf.csv")) {
+		TraceLog(LOG_WARNING, "perf_event_open unavailable; hardware counters disabled");
+	}
+#endif
+
+	std::chrono::steady_clock::time_point scene_clock = std::chrono::steady_clock::now();
+	int victory_frames = 0;
+	// the title, game over and victory screens never change: drawn on first show, copied back after that
+	static Screen::Snapshot title_scene, game_over_scene, victory_scene;
+	// One frame of the game composed into sc and resolved into frame, ready to present.
+	auto simulate = [&](Screen::Frame& frame) {
+		PROFILE_ZONE("Frame");
+		frame_arena.Reset();
+		const std::chrono::steady_clock::time_point frame_begin = std::chrono::steady_clock::now();
+		metrics.scene_ns[static_cast<size_t>(current_scene)].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(frame_begin - scene_clock).count(), std::memory_order_relaxed);
+		scene_clock = frame_begin;
+
+		frame_stats.BeginFrame();
+		if (KeyPressed(KEY_F1)) {
+			frame_stats.visible = !frame_stats.visible;
+		}
+		if (KeyPressed(KEY_F9)) {
+			Profiler::WriteChromeTrace("tbgj4_trace.json");
+		}
+
 		switch (current_scene) {
 		case Scene::START_SCENE:
-			sc.ClearScreen();
-			sc.DrawBorder(0xc9, 0xbb, 0xc8, 0xbc, 0xcd, 0xba, 0x9f);
-			sc.DrawText("An entry for GDC 4th text-based game jam", 1, 1, 0xbf);
-			sc.DrawText(
-				"  _____                            _   _\n\
+			if (title_scene.saved) {
+				sc.Restore(title_scene);
+			}
+			else {
+				sc.ClearScreen();
+				sc.DrawBorder(0xc9, 0xbb, 0xc8, 0xbc, 0xcd, 0xba, 0x9f);
+				sc.DrawStaticText("An entry for GDC 4th text-based game jam", 1, 1, 0xbf);
+				sc.DrawStaticText(
+					"  _____                            _   _\n\
  |  __ \\                          | | (_)\n\
  | |  | | ___  _ __ ___   ___  ___| |_ _  ___\n\
  | |  | |/ _ \\| '_ ` _ \\ / _ \\/ __| __| |/ __|\n\
@@ -591,20 +1337,35 @@ int main()
  | ||  __/ |  | | | (_) | |  | \__ \ | | | | | |\n\
   \\__\\___|_|  |_|  \\___/|_|  |_|___/_| |_| |_|", 16, 16, 0xbf);
 
-			sc.DrawText("Arrow keys to move\n\nC to shoot\n\n\n\nPress C to start", 16, 32, 0xbf);
+				sc.DrawStaticText("Arrow keys to move\n\nC to shoot\n\n\n\nPress C to start", 16, 32, 0xbf);
 
-			sc.DrawText("Made in raylib", 1, HEIGHT - 2, 0xbf);
-			if (IsKeyPressed(KEY_C)) {
+				sc.DrawStaticText("Made in raylib", 1, HEIGHT - 2, 0xbf);
+				sc.Save(title_scene);
+			}
+			if (KeyPressed(KEY_C)) {
 				current_scene = Scene::MAIN_GAME;
 			}
 			break;
 		case Scene::MAIN_GAME:
 			sc.ClearScreen();
 			if (g.player_lives >= 0) {
-				g.Update();
-				g.Draw(sc);
+				alloc_guard.BeginTick();
+				{
+					PERF_PHASE(UPDATE);
+					frame_stats.BeginPhase();
+					g.Update(&frame_arena);
+					frame_stats.EndUpdate();
+				}
+				{
+					PERF_PHASE(DRAW);
+					frame_stats.BeginPhase();
+					g.Draw(sc);
+					frame_stats.EndDraw();
+				}
+				alloc_guard.EndTick();
 				if (g.boss.total_health <= 0) {
 					current_scene = Scene::VICTORY;
+					victory_frames = 0;
 				}
 			}
 			else {
@@ -612,11 +1373,15 @@ int main()
 			}
 			break;
 		case Scene::GAME_OVER:
-			sc.ClearScreen();
-			sc.DrawBorder(0xc9, 0xbb, 0xc8, 0xbc, 0xcd, 0xba, 0x9f);
+			if (game_over_scene.saved) {
+				sc.Restore(game_over_scene);
+			}
+			else {
+				sc.ClearScreen();
+				sc.DrawBorder(0xc9, 0xbb, 0xc8, 0xbc, 0xcd, 0xba, 0x9f);
 
-			sc.DrawText(
-				"\
+				sc.DrawStaticText(
+					"\
 @@@@@&&&&/   . &&&&&&&&&&&&&&&&&&&&#/((,*./(%&&&&&&&&&&&&&&&&&&&&&&&&&&&&%%%%%\n\
 @@@@@@&&&,   ..%&&&&&&&&&&&&&&&&&%#(,    *#(&%&&&&&&&&&&&&&&&&&&&&&&&&&&&&%%%%\n\
 @@@@@&&&&     .&&&&&&&&&&&&&&&&&/*.          ..%&&&&&&&&&&&&&&&&&&&&&&&&&&%%%%\n\
@@ -662,16 +1427,22 @@ int main()
 \n\
 DAMN, YOU FAILED. ROT IN SPACE JAIL I GUESS. PRESS C TO RETRY.\
 ", 1, 1, 0xbf);
-			if (IsKeyPressed(KEY_C)) {
-				g = GameManager();
+				sc.Save(game_over_scene);
+			}
+			if (KeyPressed(KEY_C)) {
+				g.Reset(++seed);
 				current_scene = Scene::MAIN_GAME;
 			}
 			break;
 		case Scene::VICTORY:
-			sc.ClearScreen();
-			sc.DrawBorder(0xc9, 0xbb, 0xc8, 0xbc, 0xcd, 0xba, 0x9f);
+			if (victory_scene.saved) {
+				sc.Restore(victory_scene);
+			}
+			else {
+				sc.ClearScreen();
+				sc.DrawBorder(0xc9, 0xbb, 0xc8, 0xbc, 0xcd, 0xba, 0x9f);
 
-			sc.DrawText("\
+				sc.DrawStaticText("\
                                                                               \n\
                                   .,.                                         \n\
                        .         .,..,..                                      \n\
@@ -731,17 +1502,92 @@ DAMN, YOU FAILED. ROT IN SPACE JAIL I GUESS. PRESS C TO RETRY.\
 \n\
 YOU HAVE DOMESTICALLY TERRORIZED SPACE. PRESS C TO RETURN TO TITLE.\
 ", 1, 1, 0xbf);
-			if (IsKeyPressed(KEY_C)) {
-				g = GameManager();
+				sc.Save(victory_scene);
+			}
+			// fades in from black over a second
+			sc.screen_remap = VICTORY_FADE.steps[8 - std::min(victory_frames * 8 / FRAME_PER_SECOND, 8)];
+			++victory_frames;
+			if (KeyPressed(KEY_C)) {
+				g.Reset(++seed);
 				current_scene = Scene::START_SCENE;
 			}
 			break;
 		}
 
-		BeginDrawing();
-		ClearBackground(BLACK);
-		sc.DrawScreen();
-		EndDrawing();
+		frame_stats.player_bullets = static_cast<int>(g.player_bullets.size());
+		frame_stats.boss_bullets = static_cast<int>(g.boss_bullets.size());
+		if (frame_stats.visible) {
+			frame_stats.Draw(sc, 2, 2);
+		}
+		sc.Resolve(frame);
+	};
+
+	auto present = [&](const Screen::Frame& frame) {
+		PROFILE_ZONE("Present");
+		ALLOC_SCOPE(PRESENT);
+		PERF_PHASE(PRESENT);
+		// the clip follows whichever thread presents, so the toggle lives here rather than in simulate
+		if (KeyPressed(KEY_F10)) {
+			gif_capture.Toggle(WIDTH, HEIGHT, FRAME_PER_SECOND);
+		}
+		// an unchanged frame is not drawn; the loop only takes input and waits for the next one
+		const bool idle = sc.Idle(frame);
+		// when pipelined the F1 overlay belongs to the simulation thread, so presenting is not timed into it
+		if (terminal.active) {
+			if (!idle) {
+				if (!pipelined) frame_stats.BeginPhase();
+				sc.Present(frame);
+				if (!pipelined) frame_stats.EndDraw();
+			}
+			terminal.EndFrame();
+		}
+		else {
+			if (!idle) {
+				BeginDrawing();
+				ClearBackground(BLACK);
+				if (!pipelined) frame_stats.BeginPhase();
+				sc.Present(frame);
+				if (!pipelined) frame_stats.EndDraw();
+				EndDrawing();
+			}
+			else {
+				PollInputEvents();
+			}
+			window_pacer.EndFrame();
+		}
+		recorder.Push(frame.codepoints.data(), frame.colors.data());
+		gif_capture.Push(frame.codepoints.data(), frame.colors.data());
+	};
+
+	if (!pipelined) {
+		while (!ShouldClose()) {
+			simulate(sc.frames[0]);
+			present(sc.frames[0]);
+			frame_stats.EndFrame();
+			perf_counters.EndFrame();
+		}
+		return 0;
+	}
+
+	FramePipeline pipeline;
+	std::thread simulation([&] {
+		PinCurrentThread(simulation_cpu);
+		for (uint64_t frame = 0; pipeline.WaitToSimulate(frame); ++frame) {
+			input_snapshot = &pipeline.Input(frame);
+			simulate(sc.frames[frame % 2]);
+			frame_stats.EndFrame();
+			pipeline.Publish(frame);
+		}
+	});
+	PinCurrentThread(render_cpu);
+	InputSnapshot input;
+	for (uint64_t frame = 0; !input.close; ++frame) {
+		pipeline.WaitForFrame(frame);
+		input.Capture();
+		pipeline.Take(frame, input);
+		present(sc.frames[frame % 2]);
 	}
+	pipeline.Stop();
+	simulation.join();
 	return 0;
 }
\ No newline at end of file
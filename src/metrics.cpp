@@ -0,0 +1,142 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(TBGJ4_METRICS) && !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace {
+
+struct Writer {
+	char* out;
+	size_t capacity, size = 0;
+
+	template <typename... Args>
+	void Print(const char* format, Args... args) {
+		if (size >= capacity) return;
+		const int written = snprintf(out + size, capacity - size, format, args...);
+		if (written > 0) size = std::min(capacity, size + static_cast<size_t>(written));
+	}
+
+	template <size_t N>
+	void WriteHistogram(const char* name, const char* help, const Histogram<N>& histogram) {
+		Print("# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+		uint64_t cumulative = 0;
+		for (size_t i = 0; i < N; ++i) {
+			cumulative += histogram.buckets[i].load(std::memory_order_relaxed);
+			Print("%s_bucket{le=\"%g\"} %llu\n", name, histogram.upper_bounds_ns[i] / 1e9, static_cast<unsigned long long>(cumulative));
+		}
+		cumulative += histogram.buckets[N].load(std::memory_order_relaxed);
+		Print("%s_bucket{le=\"+Inf\"} %llu\n", name, static_cast<unsigned long long>(cumulative));
+		Print("%s_sum %.9f\n", name, histogram.sum_ns.load(std::memory_order_relaxed) / 1e9);
+		Print("%s_count %llu\n", name, static_cast<unsigned long long>(cumulative));
+	}
+
+	void WriteValue(const char* name, const char* type, const char* help, uint64_t value) {
+		Print("# HELP %s %s\n# TYPE %s %s\n%s %llu\n", name, help, name, type, name, static_cast<unsigned long long>(value));
+	}
+};
+
+}
+
+size_t Metrics::Format(char* out, size_t capacity) const {
+	Writer writer{ out, capacity };
+	writer.WriteHistogram("tbgj4_frame_seconds", "Time between presented frames.", frame_time);
+	writer.WriteHistogram("tbgj4_tick_seconds", "GameManager::Update duration.", tick_time);
+	writer.WriteHistogram("tbgj4_draw_screen_seconds", "Screen::Present duration.", draw_screen_time);
+	writer.WriteValue("tbgj4_ticks_total", "counter", "Simulation ticks run.", ticks.load(std::memory_order_relaxed));
+	writer.WriteValue("tbgj4_frames_total", "counter", "Frames presented.", frames.load(std::memory_order_relaxed));
+	writer.WriteValue("tbgj4_idle_frames_total", "counter", "Frames not presented because nothing on screen changed.", idle_frames.load(std::memory_order_relaxed));
+	writer.WriteValue("tbgj4_dropped_spawns_total", "counter", "Bullets not spawned because the pool was full.", dropped_spawns.load(std::memory_order_relaxed));
+
+	writer.Print("# HELP tbgj4_bullets Live bullets.\n# TYPE tbgj4_bullets gauge\n");
+	writer.Print("tbgj4_bullets{owner=\"player\"} %llu\n", static_cast<unsigned long long>(player_bullets.load(std::memory_order_relaxed)));
+	writer.Print("tbgj4_bullets{owner=\"boss\"} %llu\n", static_cast<unsigned long long>(boss_bullets.load(std::memory_order_relaxed)));
+	writer.Print("# HELP tbgj4_bullet_capacity Bullet pool capacity.\n# TYPE tbgj4_bullet_capacity gauge\n");
+	writer.Print("tbgj4_bullet_capacity{owner=\"player\"} %llu\n", static_cast<unsigned long long>(player_bullet_capacity.load(std::memory_order_relaxed)));
+	writer.Print("tbgj4_bullet_capacity{owner=\"boss\"} %llu\n", static_cast<unsigned long long>(boss_bullet_capacity.load(std::memory_order_relaxed)));
+
+	writer.Print("# HELP tbgj4_scene_seconds_total Wall time spent in each scene.\n# TYPE tbgj4_scene_seconds_total counter\n");
+	for (size_t i = 0; i < SCENES; ++i) {
+		writer.Print("tbgj4_scene_seconds_total{scene=\"%s\"} %.6f\n", SCENE_NAMES[i], scene_ns[i].load(std::memory_order_relaxed) / 1e9);
+	}
+	return writer.size;
+}
+
+#if defined(TBGJ4_METRICS) && !defined(_WIN32)
+
+bool MetricsServer::Start(uint16_t port) {
+	if (running.load()) return true;
+
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0) return false;
+	const int reuse = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 4) != 0) {
+		close(listen_fd);
+		listen_fd = -1;
+		return false;
+	}
+
+	running.store(true);
+	thread = std::thread([this] { Serve(); });
+	return true;
+}
+
+void MetricsServer::Stop() {
+	if (!running.exchange(false)) return;
+	thread.join();
+	close(listen_fd);
+	listen_fd = -1;
+}
+
+void MetricsServer::Serve() {
+	// static so scrapes never touch the heap
+	static char request[1024];
+	static char body[16384];
+	static char header[256];
+
+	while (running.load(std::memory_order_relaxed)) {
+		pollfd listener{ listen_fd, POLLIN, 0 };
+		if (poll(&listener, 1, 200) <= 0) continue;
+
+		const int client = accept(listen_fd, nullptr, nullptr);
+		if (client < 0) continue;
+
+		// one read is enough for a scrape request; anything else gets the same answer
+		pollfd readable{ client, POLLIN, 0 };
+		if (poll(&readable, 1, 1000) > 0) {
+			(void)recv(client, request, sizeof(request), 0);
+		}
+
+		const size_t body_size = metrics.Format(body, sizeof(body));
+		const int header_size = snprintf(header, sizeof(header),
+			"HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", body_size);
+		(void)send(client, header, static_cast<size_t>(header_size), MSG_NOSIGNAL);
+		(void)send(client, body, body_size, MSG_NOSIGNAL);
+		close(client);
+	}
+}
+
+#else
+
+bool MetricsServer::Start(uint16_t) { return false; }
+void MetricsServer::Stop() {}
+void MetricsServer::Serve() {}
+
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// Live performance counters. The game thread only does relaxed atomic adds and stores;
+// MetricsServer reads them from its own thread and serves Prometheus text on localhost.
+
+template <size_t N>
+struct Histogram {
+	std::array<uint64_t, N> upper_bounds_ns;
+	std::array<std::atomic<uint64_t>, N + 1> buckets{};
+	std::atomic<uint64_t> sum_ns{ 0 };
+
+	constexpr explicit Histogram(const std::array<uint64_t, N>& upper_bounds_ns) : upper_bounds_ns(upper_bounds_ns) {}
+
+	void Observe(uint64_t ns) {
+		size_t bucket = 0;
+		while (bucket < N && ns > upper_bounds_ns[bucket]) ++bucket;
+		buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		sum_ns.fetch_add(ns, std::memory_order_relaxed);
+	}
+};
+
+struct Metrics {
+	static constexpr size_t SCENES = 4;
+	// indexed by Scene
+	static constexpr const char* SCENE_NAMES[SCENES] = { "start", "main_game", "game_over", "victory" };
+
+	Histogram<9> frame_time{ { 1000000, 2000000, 4000000, 8000000, 16700000, 20000000, 33400000, 50000000, 100000000 } };
+	Histogram<8> tick_time{ { 50000, 100000, 250000, 500000, 1000000, 2000000, 4000000, 8000000 } };
+	Histogram<8> draw_screen_time{ { 250000, 500000, 1000000, 2000000, 4000000, 8000000, 16000000, 32000000 } };
+
+	std::atomic<uint64_t> ticks{ 0 };
+	std::atomic<uint64_t> frames{ 0 };
+	std::atomic<uint64_t> idle_frames{ 0 };
+	std::atomic<uint64_t> player_bullets{ 0 }, boss_bullets{ 0 };
+	std::atomic<uint64_t> player_bullet_capacity{ 0 }, boss_bullet_capacity{ 0 };
+	std::atomic<uint64_t> dropped_spawns{ 0 };
+	std::array<std::atomic<uint64_t>, SCENES> scene_ns{};
+
+	// Formats everything into out without allocating; returns the number of bytes written.
+	size_t Format(char* out, size_t capacity) const;
+};
+
+inline Metrics metrics;
+
+// Background HTTP exporter bound to 127.0.0.1. Start() is a no-op unless built with TBGJ4_METRICS.
+struct MetricsServer {
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	int listen_fd = -1;
+
+	bool Start(uint16_t port);
+	void Stop();
+	~MetricsServer() { Stop(); }
+
+private:
+	void Serve();
+};
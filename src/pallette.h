@@ -2,6 +2,9 @@
 
 #include "raylib.h"
 
+#include <array>
+#include <iterator>
+
 constexpr Color PALLETTE[] = {
 	{ 64,  0,  0,255}, {102,  0,  0,255}, {140,  0,  0,255}, {178,  0,  0,255}, {217,  0,  0,255}, {255,  0,  0,255}, {255, 51, 51,255}, {255,102,102,255}, {  0, 32, 64,255}, {  0, 51,102,255}, {  0, 70,140,255}, {  0, 89,178,255}, {  0,108,217,255}, {  0,128,255,255}, { 51,153,255,255}, {102,178,255,255},
 	{ 64, 16,  0,255}, {102, 26,  0,255}, {140, 35,  0,255}, {178, 45,  0,255}, {217, 54,  0,255}, {255, 64,  0,255}, {255,102, 51,255}, {255,140,102,255}, {  0,  0, 64,255}, {  0,  0,102,255}, {  0,  0,140,255}, {  0,  0,178,255}, {  0,  0,217,255}, {  0,  0,255,255}, { 51, 51,255,255}, {102,102,255,255},
@@ -15,4 +18,53 @@ constexpr Color PALLETTE[] = {
 	{  0, 64, 48,255}, {  0,102, 77,255}, {  0,140,105,255}, {  0,178,134,255}, {  0,217,163,255}, {  0,255,191,255}, { 51,255,204,255}, {102,255,217,255}, { 26, 26, 26,255}, { 51, 51, 51,255}, { 77, 77, 77,255}, {102,102,102,255}, {128,128,128,255}, {158,158,158,255}, {191,191,191,255}, {222,222,222,255},
 	{  0, 64, 64,255}, {  0,102,102,255}, {  0,140,140,255}, {  0,178,178,255}, {  0,217,217,255}, {  0,255,255,255}, { 51,255,255,255}, {102,255,255,255}, { 26, 20, 13,255}, { 51, 41, 26,255}, { 77, 61, 38,255}, {102, 82, 51,255}, {128,102, 64,255}, {158,134,100,255}, {191,171,143,255}, {222,211,195,255},
 	{  0, 48, 64,255}, {  0, 77,102,255}, {  0,105,140,255}, {  0,134,178,255}, {  0,163,217,255}, {  0,191,255,255}, { 51,204,255,255}, {102,217,255,255}, {  0,  0,  0,255}, {  0,  0,  0,255}, {  0,  0,  0,255}, {  0,  0,  0,255}, {255,255,255,255}, {255,255,255,255}, {255,255,255,255}, {255,255,255,255}
-};
\ No newline at end of file
+};
+
+constexpr int PALLETTE_SIZE = static_cast<int>(std::size(PALLETTE));
+
+// Indirection between a colors plane entry and PALLETTE, applied when the screen is presented.
+using PalletteRemap = std::array<unsigned char, 256>;
+
+constexpr PalletteRemap IdentityRemap() {
+	PalletteRemap remap{};
+	for (int i = 0; i < 256; ++i) remap[i] = static_cast<unsigned char>(i);
+	return remap;
+}
+
+constexpr PalletteRemap SolidRemap(unsigned char color) {
+	PalletteRemap remap{};
+	remap.fill(color);
+	return remap;
+}
+
+// Maps every palette entry to the one nearest to it blended toward target by amount / 255.
+constexpr PalletteRemap BlendRemap(Color target, int amount) {
+	PalletteRemap remap = IdentityRemap();
+	for (int i = 0; i < PALLETTE_SIZE; ++i) {
+		const int r = PALLETTE[i].r + (target.r - PALLETTE[i].r) * amount / 255;
+		const int g = PALLETTE[i].g + (target.g - PALLETTE[i].g) * amount / 255;
+		const int b = PALLETTE[i].b + (target.b - PALLETTE[i].b) * amount / 255;
+		int best = 0, best_distance = 0x7fffffff;
+		for (int j = 0; j < PALLETTE_SIZE; ++j) {
+			const int dr = PALLETTE[j].r - r, dg = PALLETTE[j].g - g, db = PALLETTE[j].b - b;
+			const int distance = dr * dr + dg * dg + db * db;
+			if (distance < best_distance) {
+				best = j;
+				best_distance = distance;
+			}
+		}
+		remap[i] = static_cast<unsigned char>(best);
+	}
+	return remap;
+}
+
+// STEPS + 1 remaps from identity to fully blended, built once so effects only pick a table per frame.
+template <int STEPS>
+struct BlendRamp {
+	std::array<PalletteRemap, STEPS + 1> steps;
+
+	BlendRamp(Color target, int max_amount) {
+		steps[0] = IdentityRemap();
+		for (int i = 1; i <= STEPS; ++i) steps[i] = BlendRemap(target, max_amount * i / STEPS);
+	}
+};
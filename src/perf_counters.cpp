@@ -0,0 +1,123 @@
+#include "perf_counters.h"
+
+#if defined(TBGJ4_PERF_COUNTERS) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int OpenEvent(uint32_t type, uint64_t config, int group_fd) {
+	perf_event_attr attr{};
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group_fd == -1 ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+}
+
+bool PerfCounters::Open(const char* csv_path) {
+	constexpr uint64_t L1D_READ_MISS = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	const uint32_t types[EVENTS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+	const uint64_t configs[EVENTS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, L1D_READ_MISS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+	// cycles leads the group; other events are optional since VMs and older CPUs often lack some
+	fds[0] = OpenEvent(types[0], configs[0], -1);
+	if (fds[0] < 0) return false;
+	slots[0] = opened++;
+	for (int i = 1; i < EVENTS; ++i) {
+		fds[i] = OpenEvent(types[i], configs[i], fds[0]);
+		if (fds[i] >= 0) slots[i] = opened++;
+	}
+
+	csv = fopen(csv_path, "w");
+	if (csv != nullptr) {
+		fputs("frame,phase", csv);
+		for (const char* name : EVENT_NAMES) fprintf(csv, ",%s", name);
+		fputs(",running_percent\n", csv);
+	}
+
+	ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	Read(last);
+	return true;
+}
+
+void PerfCounters::Close() {
+	for (int& fd : fds) {
+		if (fd >= 0) close(fd);
+		fd = -1;
+	}
+	slots.fill(-1);
+	opened = 0;
+	if (csv != nullptr) fclose(csv);
+	csv = nullptr;
+}
+
+// Group read layout: count of events, time enabled, time running, then one value per event.
+bool PerfCounters::Read(Sample& sample) const {
+	uint64_t buffer[3 + EVENTS];
+	if (read(fds[0], buffer, sizeof(buffer)) < static_cast<ssize_t>(sizeof(uint64_t) * (3 + opened))) return false;
+	sample.enabled = buffer[1];
+	sample.running = buffer[2];
+	for (int i = 0; i < EVENTS; ++i) {
+		sample.counts[i] = slots[i] >= 0 ? buffer[3 + slots[i]] : 0;
+	}
+	return true;
+}
+
+#else
+
+bool PerfCounters::Open(const char*) { return false; }
+void PerfCounters::Close() {}
+bool PerfCounters::Read(Sample&) const { return false; }
+
+#endif
+
+void PerfCounters::Switch(PerfPhase phase) {
+	if (!Available()) {
+		current = phase;
+		return;
+	}
+	Sample now;
+	if (Read(now)) {
+		const size_t index = static_cast<size_t>(current);
+		const uint64_t enabled = now.enabled - last.enabled, running = now.running - last.running;
+		for (int i = 0; i < EVENTS; ++i) {
+			uint64_t delta = now.counts[i] - last.counts[i];
+			if (running > 0 && running < enabled) delta = static_cast<uint64_t>(static_cast<long double>(delta) * enabled / running);
+			frame_totals[index][i] += delta;
+		}
+		frame_enabled[index] += enabled;
+		frame_running[index] += running;
+		last = now;
+	}
+	current = phase;
+}
+
+void PerfCounters::EndFrame() {
+	if (!Available()) return;
+	Switch(current);
+	if (csv != nullptr) {
+		for (size_t phase = 1; phase < PHASES; ++phase) {
+			fprintf(csv, "%llu,%s", static_cast<unsigned long long>(frame), PHASE_NAMES[phase]);
+			for (int i = 0; i < EVENTS; ++i) {
+				if (slots[i] >= 0) fprintf(csv, ",%llu", static_cast<unsigned long long>(frame_totals[phase][i]));
+				else fputs(",", csv);
+			}
+			// below 100 the counts are estimates; 0 means the group never got onto the PMU and they are missing
+			const uint64_t enabled = frame_enabled[phase];
+			fprintf(csv, ",%llu\n", static_cast<unsigned long long>(enabled > 0 ? frame_running[phase] * 100 / enabled : 100));
+		}
+	}
+	for (std::array<uint64_t, EVENTS>& totals : frame_totals) totals.fill(0);
+	frame_enabled.fill(0);
+	frame_running.fill(0);
+	++frame;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+#include "concat.h"
+
+// Hardware counters (Linux perf_event_open) attributed to frame phases, compiled in with TBGJ4_PERF_COUNTERS.
+// Phases are exclusive: entering a nested phase charges the counts so far to the enclosing one.
+
+enum class PerfPhase : uint8_t
+{
+	NONE,
+	UPDATE,
+	// the player against the boss; bullet hits are tested inside the bullet update loops and count as UPDATE
+	COLLISION,
+	DRAW,
+	PRESENT,
+	COUNT
+};
+
+struct PerfCounters {
+	static constexpr int EVENTS = 5;
+	static constexpr size_t PHASES = static_cast<size_t>(PerfPhase::COUNT);
+	static constexpr const char* EVENT_NAMES[EVENTS] = { "cycles", "instructions", "l1d_read_misses", "llc_misses", "branch_misses" };
+	static constexpr const char* PHASE_NAMES[PHASES] = { "none", "update", "collision", "draw", "present" };
+
+	std::array<int, EVENTS> fds{ -1, -1, -1, -1, -1 };
+	// position of each event in the group read, or -1 when the CPU/kernel would not open it
+	std::array<int, EVENTS> slots{ -1, -1, -1, -1, -1 };
+	int opened = 0;
+
+	// Raw group read; counts are scaled by enabled / running when the group had to share the PMU.
+	struct Sample {
+		std::array<uint64_t, EVENTS> counts{};
+		uint64_t enabled = 0, running = 0;
+	};
+
+	PerfPhase current = PerfPhase::NONE;
+	Sample last;
+	std::array<std::array<uint64_t, EVENTS>, PHASES> frame_totals{};
+	std::array<uint64_t, PHASES> frame_enabled{}, frame_running{};
+	uint64_t frame = 0;
+	FILE* csv = nullptr;
+
+	bool Open(const char* csv_path);
+	void Close();
+	~PerfCounters() { Close(); }
+
+	bool Available() const { return opened > 0; }
+
+	void Switch(PerfPhase phase);
+
+	// Writes one CSV row per phase for the frame just finished.
+	void EndFrame();
+
+private:
+	bool Read(Sample& sample) const;
+};
+
+inline PerfCounters perf_counters;
+
+struct PerfPhaseScope {
+	PerfPhase previous;
+
+	explicit PerfPhaseScope(PerfPhase phase) : previous(perf_counters.current) { perf_counters.Switch(phase); }
+	~PerfPhaseScope() { perf_counters.Switch(previous); }
+};
+
+#ifdef TBGJ4_PERF_COUNTERS
+#define PERF_PHASE(phase) PerfPhaseScope TBGJ4_CONCAT(perf_phase_, __LINE__)(PerfPhase::phase)
+#else
+#define PERF_PHASE(phase) ((void)0)
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "concat.h"
+
+// Scoped profiling zones, compiled out unless TBGJ4_PROFILE is defined.
+// Each thread records into its own ring buffer; WriteChromeTrace dumps them all as Chrome trace JSON
+// (loadable in chrome://tracing and ui.perfetto.dev).
+
+struct ProfileEvent {
+	const char* name;
+	uint64_t begin_ns, end_ns;
+};
+
+struct ProfileBuffer {
+	static constexpr size_t CAPACITY = 1 << 16;
+
+	std::array<ProfileEvent, CAPACITY> events;
+	std::atomic<uint64_t> written{ 0 };
+	uint32_t thread_id = 0;
+
+	void Push(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+		const uint64_t index = written.load(std::memory_order_relaxed);
+		events[index & (CAPACITY - 1)] = { name, begin_ns, end_ns };
+		written.store(index + 1, std::memory_order_release);
+	}
+};
+
+struct Profiler {
+	static constexpr size_t MAX_THREADS = 16;
+
+	inline static std::array<std::atomic<ProfileBuffer*>, MAX_THREADS> buffers{};
+	inline static std::atomic<uint32_t> thread_count{ 0 };
+
+	static uint64_t Now() {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// Buffers are never freed, so a trace can still be written after a thread exits.
+	static ProfileBuffer* ThisThread() {
+		thread_local ProfileBuffer* buffer = Register();
+		return buffer;
+	}
+
+	static ProfileBuffer* Register() {
+		const uint32_t id = thread_count.fetch_add(1, std::memory_order_relaxed);
+		if (id >= MAX_THREADS) return nullptr;
+		ProfileBuffer* buffer = new ProfileBuffer();
+		buffer->thread_id = id;
+		buffers[id].store(buffer, std::memory_order_release);
+		return buffer;
+	}
+
+	// Events still being written by other threads while exporting may come out torn; fine for a debug dump.
+	static bool WriteChromeTrace(const char* path) {
+#ifdef TBGJ4_PROFILE
+		FILE* file = fopen(path, "w");
+		if (file == nullptr) return false;
+		fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+		bool first = true;
+		for (const std::atomic<ProfileBuffer*>& slot : buffers) {
+			const ProfileBuffer* buffer = slot.load(std::memory_order_acquire);
+			if (buffer == nullptr) continue;
+			const uint64_t written = buffer->written.load(std::memory_order_acquire);
+			const uint64_t begin = written > ProfileBuffer::CAPACITY ? written - ProfileBuffer::CAPACITY : 0;
+			for (uint64_t i = begin; i < written; ++i) {
+				const ProfileEvent& event = buffer->events[i & (ProfileBuffer::CAPACITY - 1)];
+				fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					first ? "" : ",", event.name, buffer->thread_id, event.begin_ns / 1000.0, (event.end_ns - event.begin_ns) / 1000.0);
+				first = false;
+			}
+		}
+		fputs("\n]}\n", file);
+		fclose(file);
+		return true;
+#else
+		(void)path;
+		return false;
+#endif
+	}
+};
+
+struct ProfileZone {
+	const char* name;
+	uint64_t begin_ns;
+
+	explicit ProfileZone(const char* name) : name(name), begin_ns(Profiler::Now()) {}
+
+	~ProfileZone() {
+		const uint64_t end_ns = Profiler::Now();
+		if (ProfileBuffer* buffer = Profiler::ThisThread()) buffer->Push(name, begin_ns, end_ns);
+	}
+};
+
+#ifdef TBGJ4_PROFILE
+#define PROFILE_ZONE(name) ProfileZone TBGJ4_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Squares counter-based generator: each output is a pure function of (counter, key),
+// so results never depend on call order or on which thread asks.
+constexpr uint32_t Squares32(uint64_t counter, uint64_t key) {
+	uint64_t x = counter * key, y = x, z = y + key;
+	x = x * x + y; x = (x >> 32) | (x << 32);
+	x = x * x + z; x = (x >> 32) | (x << 32);
+	x = x * x + y; x = (x >> 32) | (x << 32);
+	return static_cast<uint32_t>((x * x + z) >> 32);
+}
+
+// Squares wants keys with well-mixed bits and the low bit set; splitmix64 gives us that from any seed.
+constexpr uint64_t MakeSquaresKey(uint64_t seed) {
+	seed += 0x9e3779b97f4a7c15ull;
+	seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+	seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+	return (seed ^ (seed >> 31)) | 1;
+}
+
+// One stream per (seed, tick, emitter); draws inside it are addressed by index.
+struct RandomStream {
+	uint64_t key, base;
+
+	constexpr RandomStream(uint64_t seed, uint32_t tick, uint16_t emitter) :
+		key(MakeSquaresKey(seed)),
+		base((static_cast<uint64_t>(tick) << 32) | (static_cast<uint64_t>(emitter) << 16))
+	{}
+
+	constexpr uint32_t Bits(uint16_t index) const { return Squares32(base | index, key); }
+
+	// Uniform in [0, 1)
+	constexpr float Uniform(uint16_t index) const { return static_cast<float>(Bits(index) >> 8) * (1.f / 16777216.f); }
+
+	constexpr float Range(uint16_t index, float lo, float hi) const { return lo + (hi - lo) * Uniform(index); }
+
+	constexpr int Pick(uint16_t index, int count) const { return static_cast<int>((static_cast<uint64_t>(Bits(index)) * static_cast<uint64_t>(count)) >> 32); }
+
+	// Batch draw for spawn time; no loop-carried state, so the compiler can vectorize it.
+	void Fill(float* out, size_t count, float lo, float hi, uint16_t first = 0) const {
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = lo + (hi - lo) * (static_cast<float>(Squares32(base | ((first + i) & 0xffff), key) >> 8) * (1.f / 16777216.f));
+		}
+	}
+};
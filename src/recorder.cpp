@@ -0,0 +1,185 @@
+#include "recorder.h"
+
+#include "raylib.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+void PutU16(std::vector<unsigned char>& out, uint16_t value) {
+	out.push_back(static_cast<unsigned char>(value));
+	out.push_back(static_cast<unsigned char>(value >> 8));
+}
+
+void PutU32(std::vector<unsigned char>& out, uint32_t value) {
+	PutU16(out, static_cast<uint16_t>(value));
+	PutU16(out, static_cast<uint16_t>(value >> 16));
+}
+
+void PutU64(std::vector<unsigned char>& out, uint64_t value) {
+	PutU32(out, static_cast<uint32_t>(value));
+	PutU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void PutVarint(std::vector<unsigned char>& out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<unsigned char>(value));
+}
+
+enum RunOp : uint64_t { RUN_SKIP, RUN_COPY, RUN_FILL };
+
+// Shortest fill worth an op of its own instead of staying in a literal run.
+constexpr size_t MIN_FILL = 4;
+
+void EncodeRuns(const unsigned char* data, size_t size, std::vector<unsigned char>& out) {
+	size_t i = 0;
+	while (i < size) {
+		size_t j = i;
+		if (data[i] == 0) {
+			while (j < size && data[j] == 0) ++j;
+			// trailing unchanged bytes are implied by the payload ending
+			if (j == size) break;
+			PutVarint(out, (j - i) << 2 | RUN_SKIP);
+			i = j;
+			continue;
+		}
+		while (j < size && data[j] == data[i]) ++j;
+		if (j - i >= MIN_FILL) {
+			PutVarint(out, (j - i) << 2 | RUN_FILL);
+			out.push_back(data[i]);
+			i = j;
+			continue;
+		}
+		// literal until two unchanged bytes or a fill starts
+		j = i;
+		while (j < size) {
+			if (data[j] == 0 && (j + 1 == size || data[j + 1] == 0)) break;
+			if (j + MIN_FILL <= size && memcmp(data + j, data + j + 1, MIN_FILL - 1) == 0) break;
+			++j;
+		}
+		PutVarint(out, (j - i) << 2 | RUN_COPY);
+		out.insert(out.end(), data + i, data + j);
+		i = j;
+	}
+}
+
+}
+
+bool FrameRecorder::Open(const char* path, size_t columns, size_t rows, int frames_per_second, uint64_t seed) {
+	if (file != nullptr) return true;
+	file = fopen(path, "wb");
+	if (file == nullptr) return false;
+	static char buffer[1 << 16];
+	setvbuf(file, buffer, _IOFBF, sizeof(buffer));
+
+	std::vector<unsigned char> header{ 'T', 'B', 'G', 'J', '4', 'R', 'E', 'C', VERSION };
+	PutU16(header, static_cast<uint16_t>(columns));
+	PutU16(header, static_cast<uint16_t>(rows));
+	PutU16(header, static_cast<uint16_t>(frames_per_second));
+	PutU16(header, KEYFRAME_INTERVAL);
+	PutU64(header, seed);
+	fwrite(header.data(), 1, header.size(), file);
+	bytes_written = header.size();
+
+	const size_t tiles = columns * rows;
+	queue.Resize(tiles);
+	previous.assign(2 * tiles, 0);
+	delta.assign(2 * tiles, 0);
+	payload.reserve(4 * tiles);
+	segment.clear();
+	segment.reserve(8 * tiles);
+	segment_header.reserve(8);
+	frame = last_record_frame = last_keyframe = 0;
+	wrote_keyframe = false;
+
+	running.store(true);
+	thread = std::thread([this] { Run(); });
+	return true;
+}
+
+void FrameRecorder::Close() {
+	if (file == nullptr) return;
+	running.store(false);
+	thread.join();
+	payload.clear();
+	WriteRecord('E', frame - last_record_frame, payload);
+	WriteSegment();
+	fclose(file);
+	file = nullptr;
+}
+
+void FrameRecorder::Run() {
+	for (;;) {
+		uint64_t snapshot_frame;
+		const unsigned char* planes = queue.Front(snapshot_frame);
+		if (planes != nullptr) {
+			Encode(snapshot_frame, planes);
+			queue.Pop();
+			continue;
+		}
+		// drain whatever was queued before Close()
+		if (!running.load(std::memory_order_acquire) && queue.Front(snapshot_frame) == nullptr) break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(4));
+	}
+}
+
+void FrameRecorder::Encode(uint64_t snapshot_frame, const unsigned char* planes) {
+	const size_t tiles = queue.tiles;
+	const bool keyframe = !wrote_keyframe || snapshot_frame - last_keyframe >= KEYFRAME_INTERVAL;
+	if (keyframe) {
+		for (size_t i = 0; i < tiles; ++i) delta[i] = planes[i] ^ 0x20;
+		memcpy(delta.data() + tiles, planes + tiles, tiles);
+	}
+	else {
+		bool changed = false;
+		for (size_t i = 0; i < 2 * tiles; ++i) {
+			delta[i] = planes[i] ^ previous[i];
+			changed |= delta[i] != 0;
+		}
+		if (!changed) return;
+	}
+	memcpy(previous.data(), planes, 2 * tiles);
+
+	if (keyframe) WriteSegment();
+	payload.clear();
+	EncodeRuns(delta.data(), delta.size(), payload);
+	WriteRecord(keyframe ? 'K' : 'D', snapshot_frame - last_record_frame, payload);
+	last_record_frame = snapshot_frame;
+	if (keyframe) {
+		last_keyframe = snapshot_frame;
+		wrote_keyframe = true;
+	}
+}
+
+void FrameRecorder::WriteRecord(uint8_t type, uint64_t frame_gap, const std::vector<unsigned char>& data) {
+	segment.push_back(type);
+	PutVarint(segment, frame_gap);
+	PutVarint(segment, data.size());
+	segment.insert(segment.end(), data.begin(), data.end());
+}
+
+void FrameRecorder::WriteSegment() {
+	if (segment.empty()) return;
+	int compressed_size = 0;
+	unsigned char* compressed = CompressData(segment.data(), static_cast<int>(segment.size()), &compressed_size);
+	// dropping the segment would leave later deltas XORed against frames the reader never saw
+	if (compressed == nullptr) {
+		TraceLog(LOG_WARNING, "recorder: compression failed, writing %zu bytes uncompressed", segment.size());
+		compressed_size = 0;
+	}
+	const unsigned char* data = compressed != nullptr ? compressed : segment.data();
+	const size_t data_size = compressed != nullptr ? static_cast<size_t>(compressed_size) : segment.size();
+	segment_header.clear();
+	PutU32(segment_header, static_cast<uint32_t>(compressed_size));
+	PutU32(segment_header, static_cast<uint32_t>(segment.size()));
+	fwrite(segment_header.data(), 1, segment_header.size(), file);
+	fwrite(data, 1, data_size, file);
+	fflush(file);
+	bytes_written += segment_header.size() + data_size;
+	if (compressed != nullptr) MemFree(compressed);
+	segment.clear();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "frame_queue.h"
+
+// Records a session as the tile planes the screen showed (TBGJ4_RECORD=path), not as pixels.
+// The game thread only copies the planes into a FrameQueue; a background thread encodes and writes.
+//
+// Stream format, little endian:
+//   header  "TBGJ4REC" u8 version, u16 columns, u16 rows, u16 frames_per_second, u16 keyframe_interval, u64 seed
+//           (the seed of the first game; each restart adds one, as TBGJ4_SEED replays it)
+//   segment u32 compressed size, u32 size, raw DEFLATE of records; each one starts at a keyframe.
+//           A compressed size of 0 means the records follow uncompressed, size bytes of them.
+//   record  u8 type, varint frames since the previous record, varint payload size, payload
+//   type 'K' keyframe: payload XORed against a blank screen (spaces, color 0)
+//   type 'D' delta:    payload XORed against the previous record's planes
+//   type 'E' end:      no payload, closes the stream after the last frame
+// Planes are all codepoints then all final palette indices. Payloads are ops (varint count << 2 | op):
+// 0 skip count unchanged bytes, 1 copy count literal bytes that follow, 2 fill count bytes with the next one.
+// Unchanged frames write no record at all; the frame gap on the next record covers them.
+struct FrameRecorder {
+	static constexpr uint8_t VERSION = 2;
+	// ten seconds at 60 fps, so a player can seek without decoding from the start
+	static constexpr uint16_t KEYFRAME_INTERVAL = 600;
+
+	FrameQueue queue;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	FILE* file = nullptr;
+	uint64_t frame = 0;
+
+	// writer thread state
+	std::vector<unsigned char> previous, delta, payload, segment, segment_header;
+	uint64_t last_record_frame = 0, last_keyframe = 0;
+	bool wrote_keyframe = false;
+	uint64_t bytes_written = 0;
+
+	bool Open(const char* path, size_t columns, size_t rows, int frames_per_second, uint64_t seed);
+	void Close();
+	~FrameRecorder() { Close(); }
+
+	bool Active() const { return file != nullptr; }
+
+	// colors are final palette indices, after any remapping
+	void Push(const unsigned char* codepoints, const unsigned char* colors) {
+		if (file == nullptr) return;
+		queue.Push(frame++, codepoints, colors);
+	}
+
+private:
+	void Run();
+	void Encode(uint64_t frame, const unsigned char* planes);
+	void WriteRecord(uint8_t type, uint64_t frame_gap, const std::vector<unsigned char>& data);
+	void WriteSegment();
+};
+
+inline FrameRecorder recorder;
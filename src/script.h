@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+#include "raylib.h"
+#include "timer_wheel.h"
+
+// Scripts alive at once; only the boss behaviour runs today.
+constexpr size_t MAX_SCRIPTS = 4;
+
+// Fixed block pool for coroutine frames, so scripts never touch the heap once a fight starts.
+struct ScriptFramePool {
+	static constexpr size_t BLOCK_SIZE = 512;
+	static constexpr size_t BLOCKS = MAX_SCRIPTS;
+
+	struct alignas(std::max_align_t) Block {
+		union {
+			unsigned char bytes[BLOCK_SIZE];
+			Block* next;
+		};
+	};
+
+	inline static std::array<Block, BLOCKS> blocks;
+	inline static Block* free_list = nullptr;
+	inline static size_t used = 0;
+
+	// running out is a sizing bug, so it is fatal
+	static void* Allocate(size_t size) noexcept {
+		if (size > BLOCK_SIZE) {
+			TraceLog(LOG_FATAL, "script: coroutine frame of %zu bytes exceeds the %zu byte pool block", size, BLOCK_SIZE);
+			return nullptr;
+		}
+		if (free_list != nullptr) {
+			Block* block = free_list;
+			free_list = block->next;
+			return block;
+		}
+		if (used == BLOCKS) {
+			TraceLog(LOG_FATAL, "script: all %zu coroutine frames in use", BLOCKS);
+			return nullptr;
+		}
+		return &blocks[used++];
+	}
+
+	static void Deallocate(void* ptr) noexcept {
+		Block* block = static_cast<Block*>(ptr);
+		block->next = free_list;
+		free_list = block;
+	}
+};
+
+// Owning handle to a script coroutine. Scripts start suspended; ScriptScheduler::Start runs them.
+struct Script {
+	struct promise_type {
+		Script get_return_object() { return Script(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		static Script get_return_object_on_allocation_failure() { return Script(); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		static void* operator new(size_t size) noexcept { return ScriptFramePool::Allocate(size); }
+		static void operator delete(void* ptr) noexcept { ScriptFramePool::Deallocate(ptr); }
+	};
+
+	std::coroutine_handle<promise_type> handle;
+
+	Script() = default;
+	explicit Script(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+	Script(const Script&) = delete;
+	Script& operator=(const Script&) = delete;
+	Script(Script&& other) noexcept : handle(other.handle) { other.handle = {}; }
+	Script& operator=(Script&& other) noexcept {
+		if (this != &other) {
+			if (handle) handle.destroy();
+			handle = other.handle;
+			other.handle = {};
+		}
+		return *this;
+	}
+	~Script() { if (handle) handle.destroy(); }
+
+	explicit operator bool() const { return static_cast<bool>(handle); }
+	bool Done() const { return !handle || handle.done(); }
+};
+
+struct ScriptScheduler;
+
+// Raised by game code to cut a script's current wait short; the script resumes on the next tick.
+struct Signal {
+	bool raised = false;
+	ScriptScheduler* scheduler = nullptr;
+	TimerWheel<std::coroutine_handle<>, MAX_SCRIPTS>::Handle wake;
+
+	void Raise();
+};
+
+// Resumes a script only when its wait expires, so idle scripts cost nothing per tick.
+struct ScriptScheduler {
+	static constexpr uint64_t FOREVER = 1ull << 40;
+
+	TimerWheel<std::coroutine_handle<>, MAX_SCRIPTS> wheel;
+
+	struct Wait {
+		ScriptScheduler& scheduler;
+		uint64_t ticks;
+		Signal* interrupt;
+
+		bool await_ready() const noexcept { return ticks == 0 || (interrupt != nullptr && interrupt->raised); }
+
+		// A wait the wheel has no room for ends at once rather than parking the script for good.
+		bool await_suspend(std::coroutine_handle<> waiter) {
+			auto wake = scheduler.wheel.After(ticks, waiter);
+			if (!wake) return false;
+			if (interrupt != nullptr) {
+				interrupt->scheduler = &scheduler;
+				interrupt->wake = wake;
+			}
+			return true;
+		}
+
+		// true when the wait ended because the signal was raised
+		bool await_resume() noexcept {
+			if (interrupt == nullptr) return false;
+			interrupt->scheduler = nullptr;
+			return interrupt->raised;
+		}
+	};
+
+	Wait Ticks(uint64_t ticks, Signal* interrupt = nullptr) { return { *this, ticks, interrupt }; }
+	Wait Until(Signal& signal) { return { *this, FOREVER, &signal }; }
+
+	void Start(Script& script) {
+		if (script) script.handle.resume();
+	}
+
+	void Tick() {
+		wheel.Advance([](std::coroutine_handle<> waiter) { waiter.resume(); });
+	}
+
+	// Forgets every waiting script without resuming it; the caller destroys the scripts themselves.
+	void Reset() { wheel.Clear(); }
+};
+
+inline void Signal::Raise() {
+	raised = true;
+	if (scheduler != nullptr && scheduler->wheel.Pending(wake)) {
+		scheduler->wheel.Reschedule(wake, scheduler->wheel.now + 1, {});
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "alloc_hooks.h"
+
+// Writes value right-aligned into out[0, width) without printf; fills with '#' when it does not fit.
+constexpr int FormatInt(char* out, long long value, int width) {
+	const bool negative = value < 0;
+	unsigned long long magnitude = negative ? 0ull - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+	int i = width - 1;
+	do {
+		out[i--] = static_cast<char>('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0 && i >= 0);
+	if (magnitude != 0 || (negative && i < 0)) {
+		for (i = 0; i < width; ++i) out[i] = '#';
+		return width;
+	}
+	if (negative) out[i--] = '-';
+	while (i >= 0) out[i--] = ' ';
+	return width;
+}
+
+// Fixed point with two decimals, e.g. 16.67
+constexpr int FormatFixed2(char* out, float value, int width) {
+	const long long hundredths = static_cast<long long>(value * 100.f + (value < 0 ? -0.5f : 0.5f));
+	FormatInt(out, hundredths / 100, width - 3);
+	const long long fraction = hundredths < 0 ? -(hundredths % 100) : hundredths % 100;
+	out[width - 3] = '.';
+	out[width - 2] = static_cast<char>('0' + fraction / 10);
+	out[width - 1] = static_cast<char>('0' + fraction % 10);
+	return width;
+}
+
+// Preallocated per-frame counters behind the F1 overlay. Recording and drawing never allocate.
+struct FrameStats {
+	static constexpr size_t HISTORY = 120;
+	static constexpr int OVERLAY_WIDTH = 30;
+	static constexpr int OVERLAY_HEIGHT = 8;
+
+	using Clock = std::chrono::steady_clock;
+
+	std::array<float, HISTORY> frame_ms{}, update_ms{}, draw_ms{};
+	size_t head = 0, count = 0;
+
+	Clock::time_point frame_begin = Clock::now(), phase_begin;
+	uint64_t allocations_at_frame_begin = 0;
+
+	int player_bullets = 0, boss_bullets = 0;
+	int collision_tests = 0, last_collision_tests = 0;
+	uint64_t last_allocations = 0;
+
+	bool visible = false;
+
+	static float Milliseconds(Clock::duration duration) { return std::chrono::duration<float, std::milli>(duration).count(); }
+
+	void BeginFrame() {
+		const Clock::time_point now = Clock::now();
+		frame_ms[head] = Milliseconds(now - frame_begin);
+		frame_begin = now;
+		update_ms[head] = 0;
+		draw_ms[head] = 0;
+		last_collision_tests = collision_tests;
+		collision_tests = 0;
+		const uint64_t allocations = allocation_count.load(std::memory_order_relaxed);
+		last_allocations = allocations - allocations_at_frame_begin;
+		allocations_at_frame_begin = allocations;
+	}
+
+	void EndFrame() {
+		head = (head + 1) % HISTORY;
+		count = std::min(count + 1, HISTORY);
+	}
+
+	void BeginPhase() { phase_begin = Clock::now(); }
+	void EndUpdate() { update_ms[head] += Milliseconds(Clock::now() - phase_begin); }
+	void EndDraw() { draw_ms[head] += Milliseconds(Clock::now() - phase_begin); }
+
+	float Percentile(const std::array<float, HISTORY>& samples, float p) const {
+		if (count == 0) return 0;
+		std::array<float, HISTORY> sorted = samples;
+		const size_t nth = std::min(count - 1, static_cast<size_t>(p * count));
+		std::nth_element(sorted.begin(), sorted.begin() + nth, sorted.begin() + count);
+		return sorted[nth];
+	}
+
+	float AverageFrameMs() const {
+		float total = 0;
+		for (size_t i = 0; i < count; ++i) total += frame_ms[i];
+		return count > 0 ? total / count : 0;
+	}
+
+	template <typename Screen>
+	void Draw(Screen& sc, int x, int y) const {
+		constexpr unsigned char TEXT = 0xbf, LABEL = 0x9e, GOOD = 0x75, SLOW = 0x45, BAD = 0x05;
+		char line[OVERLAY_WIDTH + 1];
+		line[OVERLAY_WIDTH] = '\0';
+
+		std::fill(line, line + OVERLAY_WIDTH, ' ');
+		for (int row = 0; row < OVERLAY_HEIGHT; ++row) sc.DrawText(line, x, y + row, TEXT);
+
+		const float average = AverageFrameMs();
+		std::fill(line, line + OVERLAY_WIDTH, ' ');
+		std::copy_n("FPS", 3, line);
+		FormatInt(line + 4, average > 0 ? static_cast<long long>(1000.f / average + 0.5f) : 0, 4);
+		std::copy_n("FRAME", 5, line + 10);
+		FormatFixed2(line + 16, average, 6);
+		std::copy_n("ms", 2, line + 22);
+		sc.DrawText(line, x, y, TEXT);
+
+		// two frames per cell over two rows, worst of the pair, newest last
+		constexpr unsigned char RAMP[] = { 0x20, 0x5f, 0xdc, 0xdb };
+		constexpr int CELLS = static_cast<int>(HISTORY / 2);
+		for (int cell = 0; cell < CELLS; ++cell) {
+			const size_t newest = (head + HISTORY - 1 - 2 * (CELLS - 1 - cell)) % HISTORY;
+			const float worst = std::max(frame_ms[newest], frame_ms[(newest + HISTORY - 1) % HISTORY]);
+			const int level = std::min(3, static_cast<int>(worst / (25.f / 3.f) + 0.999f));
+			const unsigned char color = worst <= 17.f ? GOOD : worst <= 34.f ? SLOW : BAD;
+			sc.DrawTile(x + cell % OVERLAY_WIDTH, y + 1 + cell / OVERLAY_WIDTH, level == 0 ? 0xfa : RAMP[level], level == 0 ? LABEL : color);
+		}
+
+		const std::array<float, HISTORY>* phases[] = { &update_ms, &draw_ms };
+		const char* phase_names[] = { "UPD", "DRW" };
+		for (int i = 0; i < 2; ++i) {
+			std::fill(line, line + OVERLAY_WIDTH, ' ');
+			std::copy_n(phase_names[i], 3, line);
+			std::copy_n("p50", 3, line + 4);
+			FormatFixed2(line + 8, Percentile(*phases[i], 0.5f), 6);
+			std::copy_n("p99", 3, line + 15);
+			FormatFixed2(line + 19, Percentile(*phases[i], 0.99f), 6);
+			std::copy_n("ms", 2, line + 25);
+			sc.DrawText(line, x, y + 3 + i, TEXT);
+		}
+
+		std::fill(line, line + OVERLAY_WIDTH, ' ');
+		std::copy_n("BULLETS", 7, line);
+		FormatInt(line + 8, player_bullets, 5);
+		FormatInt(line + 14, boss_bullets, 5);
+		sc.DrawText(line, x, y + 5, TEXT);
+
+		std::fill(line, line + OVERLAY_WIDTH, ' ');
+		std::copy_n("COLLISION TESTS", 15, line);
+		FormatInt(line + 16, last_collision_tests, 6);
+		sc.DrawText(line, x, y + 6, TEXT);
+
+		std::fill(line, line + OVERLAY_WIDTH, ' ');
+		std::copy_n("ALLOCATIONS", 11, line);
+		FormatInt(line + 16, static_cast<long long>(last_allocations), 6);
+		sc.DrawText(line, x, y + 7, last_allocations == 0 ? TEXT : SLOW);
+	}
+};
+
+inline FrameStats frame_stats;
@@ -0,0 +1,485 @@
+#include "terminal.h"
+
+#if !defined(_WIN32)
+
+#include <algorithm>
+#include <csignal>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pallette.h"
+
+namespace {
+
+// CP437 glyphs as Unicode; 0x20-0x7e are ASCII.
+constexpr char32_t CP437_LOW[32] = {
+	0x0020, 0x263a, 0x263b, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022, 0x25d8, 0x25cb, 0x25d9, 0x2642, 0x2640, 0x266a, 0x266b, 0x263c,
+	0x25ba, 0x25c4, 0x2195, 0x203c, 0x00b6, 0x00a7, 0x25ac, 0x21a8, 0x2191, 0x2193, 0x2192, 0x2190, 0x221f, 0x2194, 0x25b2, 0x25bc,
+};
+
+constexpr char32_t CP437_HIGH[129] = {
+	0x2302,
+	0x00c7, 0x00fc, 0x00e9, 0x00e2, 0x00e4, 0x00e0, 0x00e5, 0x00e7, 0x00ea, 0x00eb, 0x00e8, 0x00ef, 0x00ee, 0x00ec, 0x00c4, 0x00c5,
+	0x00c9, 0x00e6, 0x00c6, 0x00f4, 0x00f6, 0x00f2, 0x00fb, 0x00f9, 0x00ff, 0x00d6, 0x00dc, 0x00a2, 0x00a3, 0x00a5, 0x20a7, 0x0192,
+	0x00e1, 0x00ed, 0x00f3, 0x00fa, 0x00f1, 0x00d1, 0x00aa, 0x00ba, 0x00bf, 0x2310, 0x00ac, 0x00bd, 0x00bc, 0x00a1, 0x00ab, 0x00bb,
+	0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255d, 0x255c, 0x255b, 0x2510,
+	0x2514, 0x2534, 0x252c, 0x251c, 0x2500, 0x253c, 0x255e, 0x255f, 0x255a, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256c, 0x2567,
+	0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256b, 0x256a, 0x2518, 0x250c, 0x2588, 0x2584, 0x258c, 0x2590, 0x2580,
+	0x03b1, 0x00df, 0x0393, 0x03c0, 0x03a3, 0x03c3, 0x00b5, 0x03c4, 0x03a6, 0x0398, 0x03a9, 0x03b4, 0x221e, 0x03c6, 0x03b5, 0x2229,
+	0x2261, 0x00b1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00f7, 0x2248, 0x00b0, 0x2219, 0x00b7, 0x221a, 0x207f, 0x00b2, 0x25a0, 0x00a0,
+};
+
+struct Sequence {
+	char bytes[24];
+	uint8_t size;
+};
+
+// built once by Open so Present only copies bytes
+std::array<Sequence, 256> glyphs, colors;
+
+termios saved_termios;
+bool raw_input = false;
+volatile std::sig_atomic_t resized = 1;
+
+void OnResize(int) { resized = 1; }
+
+constexpr char LEAVE[] = "\x1b[<u\x1b[0m\x1b[?25h\x1b[?1049l";
+constexpr int FATAL_SIGNALS[] = { SIGABRT, SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGTERM };
+
+// Set while the terminal needs restoring by exits that never reach Close(); async-signal-safe from here on.
+volatile std::sig_atomic_t restore_pending = 0;
+
+void RestoreTerminal() {
+	if (!restore_pending) return;
+	restore_pending = 0;
+	if (write(STDOUT_FILENO, LEAVE, sizeof(LEAVE) - 1) < 0) {}
+	if (raw_input) tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_termios);
+}
+
+void OnFatalSignal(int signal_number) {
+	RestoreTerminal();
+	signal(signal_number, SIG_DFL);
+	raise(signal_number);
+}
+
+// Keeps log lines off the frame: stderr when redirected, tbgj4.log otherwise.
+FILE* log_file = nullptr;
+
+void LogOffScreen(int level, const char* text, va_list args) {
+	static constexpr const char* LEVELS[] = { "", "TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "FATAL" };
+	FILE* out = log_file != nullptr ? log_file : stderr;
+	fprintf(out, "%s: ", level >= 0 && level < 7 ? LEVELS[level] : "");
+	vfprintf(out, text, args);
+	fputc('\n', out);
+	fflush(out);
+	// raylib only exits on its own when no callback is installed
+	if (level == LOG_FATAL) exit(EXIT_FAILURE);
+}
+
+Sequence EncodeUtf8(char32_t c) {
+	Sequence sequence{};
+	if (c < 0x80) {
+		sequence.bytes[0] = static_cast<char>(c);
+		sequence.size = 1;
+	}
+	else if (c < 0x800) {
+		sequence.bytes[0] = static_cast<char>(0xc0 | (c >> 6));
+		sequence.bytes[1] = static_cast<char>(0x80 | (c & 0x3f));
+		sequence.size = 2;
+	}
+	else {
+		sequence.bytes[0] = static_cast<char>(0xe0 | (c >> 12));
+		sequence.bytes[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+		sequence.bytes[2] = static_cast<char>(0x80 | (c & 0x3f));
+		sequence.size = 3;
+	}
+	return sequence;
+}
+
+// Nearest entry of the xterm 6x6x6 cube or gray ramp.
+int Xterm256(Color color) {
+	constexpr int LEVELS[6] = { 0, 95, 135, 175, 215, 255 };
+	const auto nearest_level = [&](int value) {
+		int best = 0;
+		for (int i = 1; i < 6; ++i) {
+			if (abs(LEVELS[i] - value) < abs(LEVELS[best] - value)) best = i;
+		}
+		return best;
+	};
+	const auto distance = [&](int r, int g, int b) { return (r - color.r) * (r - color.r) + (g - color.g) * (g - color.g) + (b - color.b) * (b - color.b); };
+
+	const int r = nearest_level(color.r), g = nearest_level(color.g), b = nearest_level(color.b);
+	const int cube = 16 + 36 * r + 6 * g + b;
+	const int cube_distance = distance(LEVELS[r], LEVELS[g], LEVELS[b]);
+
+	const int average = (color.r + color.g + color.b) / 3;
+	const int gray = std::min(23, std::max(0, (average - 8 + 5) / 10));
+	const int gray_value = 8 + 10 * gray;
+	return distance(gray_value, gray_value, gray_value) < cube_distance ? 232 + gray : cube;
+}
+
+Sequence Sgr(const char* format, int a, int b = 0, int c = 0) {
+	Sequence sequence{};
+	sequence.size = static_cast<uint8_t>(snprintf(sequence.bytes, sizeof(sequence.bytes), format, a, b, c));
+	return sequence;
+}
+
+}
+
+bool Terminal::Open(const char* mode, size_t grid_columns, size_t grid_rows, int frames_per_second) {
+	if (active) return true;
+
+	const char* colorterm = getenv("COLORTERM");
+	const bool truecolor = strcmp(mode, "truecolor") == 0 || (strcmp(mode, "256") != 0 && colorterm != nullptr && (strcmp(colorterm, "truecolor") == 0 || strcmp(colorterm, "24bit") == 0));
+	color_mode = truecolor ? ColorMode::TRUECOLOR : ColorMode::XTERM_256;
+
+	for (int i = 0; i < 256; ++i) {
+		glyphs[i] = EncodeUtf8(i < 0x20 ? CP437_LOW[i] : i < 0x7f ? static_cast<char32_t>(i) : CP437_HIGH[i - 0x7f]);
+		const Color color = i < PALLETTE_SIZE ? PALLETTE[i] : Color{ 0, 0, 0, 255 };
+		colors[i] = truecolor ? Sgr("\x1b[38;2;%d;%d;%dm", color.r, color.g, color.b) : Sgr("\x1b[38;5;%dm", Xterm256(color));
+	}
+
+	columns = grid_columns;
+	rows = grid_rows;
+	shown_codepoints.assign(columns * rows, 0);
+	shown_colors.assign(columns * rows, 0);
+	full_redraw = true;
+	frame_period = std::chrono::nanoseconds(1000000000 / frames_per_second);
+	next_frame = std::chrono::steady_clock::now();
+	partial_size = 0;
+
+	long repeat_delay_ms = DEFAULT_REPEAT_DELAY_MS;
+	const char* repeat_delay = getenv("TBGJ4_KEY_REPEAT_DELAY");
+	if (repeat_delay != nullptr) {
+		char* end = nullptr;
+		const long value = strtol(repeat_delay, &end, 10);
+		if (end == repeat_delay || *end != '\0' || value < 0 || value > 10000) {
+			TraceLog(LOG_WARNING, "TBGJ4_KEY_REPEAT_DELAY must be milliseconds from 0 to 10000, got \"%s\"; using %d", repeat_delay, DEFAULT_REPEAT_DELAY_MS);
+		}
+		else {
+			repeat_delay_ms = value;
+		}
+	}
+	// one repeat gap on top, so the first repeat lands inside the window
+	first_hold_frames = static_cast<uint64_t>(repeat_delay_ms * frames_per_second / 1000) + REPEAT_HOLD_FRAMES;
+
+	if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_termios) == 0) {
+		termios raw = saved_termios;
+		raw.c_iflag &= ~(ICRNL | IXON | ISTRIP | BRKINT);
+		raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+		raw.c_cc[VMIN] = 0;
+		raw.c_cc[VTIME] = 0;
+		raw_input = tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == 0;
+	}
+	signal(SIGWINCH, OnResize);
+	resized = 1;
+
+	static bool exit_hook = false;
+	if (!exit_hook) exit_hook = atexit(RestoreTerminal) == 0;
+	for (int signal_number : FATAL_SIGNALS) signal(signal_number, OnFatalSignal);
+	restore_pending = 1;
+
+	if (isatty(STDERR_FILENO)) log_file = fopen("tbgj4.log", "a");
+	SetTraceLogCallback(LogOffScreen);
+
+	active = true;
+	// alternate screen, hidden cursor, and where supported the kitty keyboard protocol with every key
+	// as an escape code so releases are reported too; the query reply tells whether it took
+	static constexpr char ENTER[] = "\x1b[?1049h\x1b[?25l\x1b[>11u\x1b[?u";
+	Write(ENTER, sizeof(ENTER) - 1);
+	Flush();
+	return true;
+}
+
+void Terminal::Close() {
+	if (!active) return;
+	Write(LEAVE, sizeof(LEAVE) - 1);
+	Flush();
+	restore_pending = 0;
+	for (int signal_number : FATAL_SIGNALS) signal(signal_number, SIG_DFL);
+	if (raw_input) tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_termios);
+	raw_input = false;
+	signal(SIGWINCH, SIG_DFL);
+	SetTraceLogCallback(nullptr);
+	if (log_file != nullptr) fclose(log_file);
+	log_file = nullptr;
+	active = false;
+}
+
+void Terminal::Write(const char* data, size_t size) {
+	if (output_size + size > output.size()) Flush();
+	memcpy(output.data() + output_size, data, size);
+	output_size += size;
+}
+
+void Terminal::Flush() {
+	size_t written = 0;
+	while (written < output_size) {
+		const ssize_t result = write(STDOUT_FILENO, output.data() + written, output_size - written);
+		if (result <= 0) break;
+		written += static_cast<size_t>(result);
+	}
+	last_frame_bytes += written;
+	output_size = 0;
+}
+
+void Terminal::MoveTo(int x, int y) {
+	char sequence[24];
+	const int size = snprintf(sequence, sizeof(sequence), "\x1b[%d;%dH", y + 1, x + 1);
+	Write(sequence, static_cast<size_t>(size));
+}
+
+void Terminal::Resize() {
+	resized = 0;
+	winsize size{};
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+		visible_columns = std::min<int>(size.ws_col, static_cast<int>(columns));
+		visible_rows = std::min<int>(size.ws_row, static_cast<int>(rows));
+	}
+	else {
+		visible_columns = static_cast<int>(columns);
+		visible_rows = static_cast<int>(rows);
+	}
+	full_redraw = true;
+}
+
+bool Terminal::Resized() const { return resized != 0; }
+
+void Terminal::Present(const unsigned char* codepoints, const unsigned char* tile_colors) {
+	if (!active) return;
+	if (resized) Resize();
+	last_frame_bytes = 0;
+
+	if (full_redraw) {
+		// black background for the whole terminal, not just the grid
+		static constexpr char CLEAR[] = "\x1b[0m\x1b[48;5;16m\x1b[2J";
+		Write(CLEAR, sizeof(CLEAR) - 1);
+	}
+
+	// no cursor position or color is assumed across frames
+	int cursor_x = -1, cursor_y = -1, current_color = -1;
+	for (int y = 0; y < visible_rows; ++y) {
+		for (int x = 0; x < visible_columns; ++x) {
+			const size_t i = static_cast<size_t>(y) * columns + x;
+			const unsigned char codepoint = codepoints[i] == 0x00 ? 0x20 : codepoints[i];
+			const unsigned char color = codepoint == 0x20 ? 0xff : tile_colors[i];
+			if (!full_redraw && shown_codepoints[i] == codepoint && shown_colors[i] == color) continue;
+
+			if (cursor_y != y || cursor_x > x) {
+				MoveTo(x, y);
+			}
+			else if (cursor_x < x) {
+				// rewriting a few unchanged cells is shorter than a cursor move when they need no color change
+				const int gap = x - cursor_x;
+				bool rewrite = gap <= 3;
+				for (int j = cursor_x; rewrite && j < x; ++j) {
+					const unsigned char gap_color = shown_colors[i - (x - j)];
+					rewrite = gap_color == 0xff || gap_color == current_color;
+				}
+				if (rewrite) {
+					for (int j = cursor_x; j < x; ++j) {
+						const Sequence& glyph = glyphs[shown_codepoints[i - (x - j)]];
+						Write(glyph.bytes, glyph.size);
+					}
+				}
+				else {
+					char sequence[16];
+					const int size = snprintf(sequence, sizeof(sequence), "\x1b[%dC", gap);
+					Write(sequence, static_cast<size_t>(size));
+				}
+			}
+
+			if (color != 0xff && color != current_color) {
+				Write(colors[color].bytes, colors[color].size);
+				current_color = color;
+			}
+			Write(glyphs[codepoint].bytes, glyphs[codepoint].size);
+			shown_codepoints[i] = codepoint;
+			shown_colors[i] = color;
+
+			cursor_y = y;
+			// writing the last column leaves the cursor in a pending wrap state; just move next time
+			cursor_x = x + 1 < visible_columns ? x + 1 : -1;
+		}
+	}
+	full_redraw = false;
+}
+
+void Terminal::EndFrame() {
+	if (!active) return;
+	Flush();
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	next_frame += frame_period;
+	if (next_frame < now - frame_period) next_frame = now;
+	std::this_thread::sleep_until(next_frame);
+
+	++frame;
+	tapped.fill(false);
+	ReadInput();
+	for (size_t key = 0; key < KEYS; ++key) {
+		const bool is_down = KeyDown(static_cast<int>(key));
+		pressed[key] = (is_down && !was_down[key]) || tapped[key];
+		was_down[key] = is_down;
+	}
+}
+
+// event: 1 press, 2 repeat, 3 release, 0 when the terminal does not say
+void Terminal::Key(int key, int event) {
+	if (key < 0 || static_cast<size_t>(key) >= KEYS) return;
+	if (event == 0) {
+		reports_release[key] = false;
+		const bool held = KeyDown(key);
+		tapped[key] = tapped[key] || !held;
+		repeating[key] = held;
+		last_repeat[key] = frame;
+		return;
+	}
+	reports_release[key] = true;
+	down[key] = event != 3;
+	if (event == 1) tapped[key] = true;
+}
+
+void Terminal::ReadInput() {
+	unsigned char buffer[sizeof(partial) + 256];
+	for (;;) {
+		pollfd readable{ STDIN_FILENO, POLLIN, 0 };
+		if (poll(&readable, 1, 0) <= 0) return;
+		memcpy(buffer, partial.data(), partial_size);
+		const ssize_t received = read(STDIN_FILENO, buffer + partial_size, sizeof(buffer) - partial_size);
+		if (received <= 0) return;
+		const ssize_t size = static_cast<ssize_t>(partial_size) + received;
+		partial_size = 0;
+		// anything longer than partial is no key we know
+		const auto carry = [&](ssize_t from) {
+			if (static_cast<size_t>(size - from) > partial.size()) return;
+			partial_size = static_cast<size_t>(size - from);
+			memcpy(partial.data(), buffer + from, partial_size);
+		};
+
+		for (ssize_t i = 0; i < size; ++i) {
+			const unsigned char c = buffer[i];
+			if (c == 0x03 || c == 'q' || c == 'Q') {
+				quit = true;
+				continue;
+			}
+			if (c == 'c' || c == 'C') {
+				Key(KEY_C, 0);
+				continue;
+			}
+			if (c != 0x1b) continue;
+			if (i + 1 >= size) {
+				carry(i);
+				break;
+			}
+
+			// SS3: ESC O <final>, used for F1-F4 and application-mode arrows
+			if (buffer[i + 1] == 'O') {
+				if (i + 2 >= size) {
+					carry(i);
+					break;
+				}
+				const unsigned char final = buffer[i + 2];
+				i += 2;
+				switch (final) {
+				case 'A': Key(KEY_UP, 0); break;
+				case 'B': Key(KEY_DOWN, 0); break;
+				case 'C': Key(KEY_RIGHT, 0); break;
+				case 'D': Key(KEY_LEFT, 0); break;
+				case 'P': Key(KEY_F1, 0); break;
+				}
+				continue;
+			}
+			if (buffer[i + 1] != '[') continue;
+
+			// CSI params final; params are numbers separated by ';' with optional ':' sub-fields
+			int params[2] = { 0, 1 }, event = 0, param = 0;
+			bool sub_field = false;
+			const bool query_reply = i + 2 < size && buffer[i + 2] == '?';
+			ssize_t j = i + 2;
+			for (; j < size && buffer[j] >= 0x30 && buffer[j] <= 0x3f; ++j) {
+				const unsigned char p = buffer[j];
+				if (p == ';') {
+					++param;
+					sub_field = false;
+					if (param < 2) params[param] = 0;
+				}
+				else if (p == ':') {
+					sub_field = true;
+					if (param == 1) event = 0;
+				}
+				else if (p >= '0' && p <= '9') {
+					if (sub_field && param == 1) event = event * 10 + (p - '0');
+					else if (!sub_field && param < 2) params[param] = params[param] * 10 + (p - '0');
+				}
+			}
+			if (j >= size) {
+				carry(i);
+				break;
+			}
+			const unsigned char final = buffer[j];
+			i = j;
+			if (query_reply) {
+				keyboard_protocol = keyboard_protocol || final == 'u';
+				continue;
+			}
+			// with the protocol on, a missing event type means press
+			if (keyboard_protocol && event == 0) event = 1;
+
+			const bool ctrl = ((params[1] - 1) & 4) != 0;
+			switch (final) {
+			case 'A': Key(KEY_UP, event); break;
+			case 'B': Key(KEY_DOWN, event); break;
+			case 'C': Key(KEY_RIGHT, event); break;
+			case 'D': Key(KEY_LEFT, event); break;
+			case 'P': Key(KEY_F1, event); break;
+			case '~':
+				if (params[0] == 11) Key(KEY_F1, event);
+				else if (params[0] == 20) Key(KEY_F9, event);
+				else if (params[0] == 21) Key(KEY_F10, event);
+				break;
+			case 'u':
+				// kitty protocol: params[0] is the unshifted codepoint
+				if ((params[0] == 'q' || (params[0] == 'c' && ctrl)) && event != 3) quit = true;
+				else if (params[0] == 'c') Key(KEY_C, event);
+				break;
+			}
+		}
+	}
+}
+
+bool Terminal::KeyDown(int key) const {
+	if (key < 0 || static_cast<size_t>(key) >= KEYS) return false;
+	if (reports_release[key]) return down[key];
+	return last_repeat[key] != 0 && frame - last_repeat[key] < (repeating[key] ? REPEAT_HOLD_FRAMES : first_hold_frames);
+}
+
+bool Terminal::KeyPressed(int key) const {
+	return key >= 0 && static_cast<size_t>(key) < KEYS && pressed[key];
+}
+
+#else
+
+bool Terminal::Open(const char*, size_t, size_t, int) { return false; }
+void Terminal::Close() {}
+void Terminal::Present(const unsigned char*, const unsigned char*) {}
+void Terminal::EndFrame() {}
+bool Terminal::Resized() const { return false; }
+bool Terminal::KeyDown(int) const { return false; }
+bool Terminal::KeyPressed(int) const { return false; }
+void Terminal::Write(const char*, size_t) {}
+void Terminal::Flush() {}
+void Terminal::MoveTo(int, int) {}
+void Terminal::ReadInput() {}
+void Terminal::Key(int, int) {}
+void Terminal::Resize() {}
+
+#endif
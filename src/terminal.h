@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Plays the game in a plain terminal instead of a window (TBGJ4_TERMINAL=1, 256 or truecolor), writing only
+// the cells that changed. Keys count as held while they auto-repeat, or exactly with the kitty keyboard protocol;
+// TBGJ4_KEY_REPEAT_DELAY=<ms> (default 660) covers the wait for the first repeat. POSIX only.
+struct Terminal {
+	enum class ColorMode : uint8_t
+	{
+		XTERM_256,
+		TRUECOLOR
+	};
+
+	static constexpr size_t KEYS = 512;
+	// covers the gap between auto-repeats once they have started
+	static constexpr uint64_t REPEAT_HOLD_FRAMES = 8;
+	static constexpr int DEFAULT_REPEAT_DELAY_MS = 660;
+	static constexpr size_t OUTPUT_CAPACITY = 1 << 16;
+
+	bool active = false;
+	bool quit = false;
+	// set once the terminal confirms the kitty keyboard protocol
+	bool keyboard_protocol = false;
+	ColorMode color_mode = ColorMode::XTERM_256;
+
+	size_t columns = 0, rows = 0;
+	int visible_columns = 0, visible_rows = 0;
+	bool full_redraw = true;
+	// what the terminal currently shows; colors are 0xff for blank cells, whose color does not matter
+	std::vector<unsigned char> shown_codepoints, shown_colors;
+
+	std::array<char, OUTPUT_CAPACITY> output;
+	size_t output_size = 0;
+	uint64_t last_frame_bytes = 0;
+
+	uint64_t frame = 0;
+	// how long a fresh press is held, past the initial repeat delay
+	uint64_t first_hold_frames = 0;
+	std::array<uint64_t, KEYS> last_repeat{};
+	std::array<bool, KEYS> reports_release{}, repeating{}, down{}, was_down{}, pressed{}, tapped{};
+	// an escape sequence split across reads, finished by the next one
+	std::array<unsigned char, 32> partial{};
+	size_t partial_size = 0;
+
+	std::chrono::nanoseconds frame_period{};
+	std::chrono::steady_clock::time_point next_frame;
+
+	bool Open(const char* mode, size_t columns, size_t rows, int frames_per_second);
+	void Close();
+	~Terminal() { Close(); }
+
+	// colors are final palette indices, after any remapping
+	void Present(const unsigned char* codepoints, const unsigned char* colors);
+
+	// Flushes the frame, sleeps until the next one is due and reads pending input.
+	void EndFrame();
+
+	// The terminal changed size since the last Present, which then redraws everything.
+	bool Resized() const;
+
+	bool KeyDown(int key) const;
+	bool KeyPressed(int key) const;
+
+private:
+	void Write(const char* data, size_t size);
+	void Flush();
+	void MoveTo(int x, int y);
+	void ReadInput();
+	void Key(int key, int event);
+	void Resize();
+};
+
+inline Terminal terminal;
@@ -0,0 +1,24 @@
+#pragma once
+
+// Draws the whole tile grid as one quad. texture0 is the grid itself, one texel per tile with the
+// codepoint in red and the already remapped palette index in alpha (GRAY_ALPHA). Glyphs come from the
+// 16x16 atlas of 8x8 cells and tints from a 256x1 palette texture; texelFetch keeps every lookup exact.
+// GLSL 330 so it runs on raylib's default GL 3.3 context, including Mesa llvmpipe.
+constexpr const char* TILEMAP_FRAGMENT_SHADER = R"(#version 330
+in vec2 fragTexCoord;
+in vec4 fragColor;
+out vec4 finalColor;
+
+uniform sampler2D texture0;
+uniform sampler2D font;
+uniform sampler2D pallette;
+
+void main() {
+	vec2 cell = fragTexCoord * vec2(textureSize(texture0, 0));
+	vec4 tile = texelFetch(texture0, ivec2(cell), 0);
+	int codepoint = int(tile.r * 255.0 + 0.5);
+	int color = int(tile.a * 255.0 + 0.5);
+	ivec2 glyph = ivec2(codepoint % 16, codepoint / 16) * 8 + ivec2(fract(cell) * 8.0);
+	finalColor = texelFetch(font, glyph, 0) * texelFetch(pallette, ivec2(color, 0), 0) * fragColor;
+}
+)";
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "raylib.h"
+
+// Hierarchical timer wheel with absolute tick deadlines; idle timers cost nothing per tick.
+// Nodes live in a fixed pool and link by index, so the wheel never allocates.
+template <typename T, size_t CAPACITY = 256>
+struct TimerWheel {
+	static constexpr int SLOT_BITS = 6;
+	static constexpr uint64_t SLOTS = 1ull << SLOT_BITS;
+	static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+	static constexpr int LEVELS = 3;
+	static constexpr int32_t NONE = -1;
+
+	struct Handle {
+		int32_t index = NONE;
+		uint32_t generation = 0;
+
+		// false when the timer could not be scheduled
+		explicit operator bool() const { return index != NONE; }
+	};
+
+	struct Node {
+		uint64_t due = 0;
+		T payload{};
+		int32_t prev = NONE, next = NONE;
+		int32_t bucket = NONE;
+		uint32_t generation = 0;
+	};
+
+	std::array<Node, CAPACITY> nodes;
+	std::array<int32_t, LEVELS * SLOTS> buckets;
+	int32_t free_list = 0;
+	uint64_t now = 0;
+	size_t active = 0;
+
+	TimerWheel() { Clear(); }
+
+	// Drops every timer and restarts at tick 0. Handles from before never match again.
+	void Clear() {
+		buckets.fill(NONE);
+		for (size_t i = 0; i < CAPACITY; ++i) {
+			nodes[i].next = i + 1 < CAPACITY ? static_cast<int32_t>(i + 1) : NONE;
+			nodes[i].bucket = NONE;
+			++nodes[i].generation;
+		}
+		free_list = 0;
+		now = 0;
+		active = 0;
+	}
+
+	// Past deadlines fire on the next Advance(). The handle comes back empty when every node is in use.
+	Handle At(uint64_t due, const T& payload) {
+		if (free_list == NONE) {
+			TraceLog(LOG_ERROR, "timer wheel: all %zu timers in use, timer dropped", CAPACITY);
+			return {};
+		}
+		const int32_t index = free_list;
+		Node& node = nodes[index];
+		free_list = node.next;
+		node.due = due > now ? due : now + 1;
+		node.payload = payload;
+		Insert(index);
+		++active;
+		return { index, node.generation };
+	}
+
+	Handle After(uint64_t delay, const T& payload) { return At(now + delay, payload); }
+
+	bool Pending(const Handle& handle) const {
+		return handle.index != NONE && nodes[handle.index].generation == handle.generation && nodes[handle.index].bucket != NONE;
+	}
+
+	void Cancel(Handle& handle) {
+		if (Pending(handle)) {
+			Unlink(handle.index);
+			Release(handle.index);
+		}
+		handle = {};
+	}
+
+	// Moves a pending timer, or schedules a fresh one when it has already fired.
+	void Reschedule(Handle& handle, uint64_t due, const T& payload) {
+		if (Pending(handle)) {
+			Unlink(handle.index);
+			nodes[handle.index].due = due > now ? due : now + 1;
+			Insert(handle.index);
+		}
+		else {
+			handle = At(due, payload);
+		}
+	}
+
+	template <typename F>
+	void Advance(F&& fire) {
+		++now;
+		if ((now & SLOT_MASK) == 0) {
+			if (((now >> SLOT_BITS) & SLOT_MASK) == 0) {
+				Cascade(2 * SLOTS + ((now >> (2 * SLOT_BITS)) & SLOT_MASK));
+			}
+			Cascade(SLOTS + ((now >> SLOT_BITS) & SLOT_MASK));
+		}
+
+		// pop one at a time so a callback may schedule or cancel other timers safely
+		int32_t& bucket = buckets[now & SLOT_MASK];
+		while (bucket != NONE) {
+			const int32_t index = bucket;
+			Unlink(index);
+			const T payload = nodes[index].payload;
+			Release(index);
+			fire(payload);
+		}
+	}
+
+private:
+	void Insert(int32_t index) {
+		Node& node = nodes[index];
+		const uint64_t delta = node.due - now;
+		int32_t bucket;
+		if (delta < SLOTS) {
+			bucket = static_cast<int32_t>(node.due & SLOT_MASK);
+		}
+		else if (delta < SLOTS * SLOTS) {
+			bucket = static_cast<int32_t>(SLOTS + ((node.due >> SLOT_BITS) & SLOT_MASK));
+		}
+		else if (delta < SLOTS * SLOTS * SLOTS) {
+			bucket = static_cast<int32_t>(2 * SLOTS + ((node.due >> (2 * SLOT_BITS)) & SLOT_MASK));
+		}
+		else {
+			// beyond the wheel: park in the last top-level slot and re-sort when it cascades
+			bucket = static_cast<int32_t>(2 * SLOTS + (((now >> (2 * SLOT_BITS)) - 1) & SLOT_MASK));
+		}
+		node.bucket = bucket;
+		node.prev = NONE;
+		node.next = buckets[bucket];
+		if (node.next != NONE) nodes[node.next].prev = index;
+		buckets[bucket] = index;
+	}
+
+	void Unlink(int32_t index) {
+		Node& node = nodes[index];
+		if (node.prev != NONE) nodes[node.prev].next = node.next;
+		else buckets[node.bucket] = node.next;
+		if (node.next != NONE) nodes[node.next].prev = node.prev;
+		node.bucket = NONE;
+	}
+
+	void Release(int32_t index) {
+		Node& node = nodes[index];
+		++node.generation;
+		node.next = free_list;
+		free_list = index;
+		--active;
+	}
+
+	void Cascade(size_t bucket) {
+		int32_t index = buckets[bucket];
+		buckets[bucket] = NONE;
+		while (index != NONE) {
+			const int32_t next = nodes[index].next;
+			Insert(index);
+			index = next;
+		}
+	}
+};
@@ -0,0 +1,29 @@
+#include "window_pacer.h"
+
+#ifdef TBGJ4_GLFW_WAIT
+// raylib builds GLFW in; the TBGJ4_GLFW_WAIT option puts its headers on the include path
+#include "GLFW/glfw3.h"
+#else
+#include "raylib.h"
+#endif
+
+void WindowPacer::Open(int frames_per_second) {
+	frame_period = std::chrono::nanoseconds(1000000000 / frames_per_second);
+	next_frame = std::chrono::steady_clock::now();
+}
+
+void WindowPacer::EndFrame() {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	next_frame += frame_period;
+	if (next_frame < now - frame_period) next_frame = now;
+	while (now < next_frame) {
+#ifdef TBGJ4_GLFW_WAIT
+		// An event ends the wait early; its input lands in raylib's key state right away, but the frame still
+		// starts on time since scenes count frames, not seconds.
+		glfwWaitEventsTimeout(std::chrono::duration<double>(next_frame - now).count());
+#else
+		WaitTime(std::chrono::duration<double>(next_frame - now).count());
+#endif
+		now = std::chrono::steady_clock::now();
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <chrono>
+
+// Frame pacing for the window in place of SetTargetFPS, so a frame that draws nothing can skip EndDrawing.
+// TBGJ4_GLFW_WAIT waits on GLFW's event queue instead of WaitTime; it needs the desktop raylib in libs/raylib.
+struct WindowPacer {
+	std::chrono::nanoseconds frame_period{};
+	std::chrono::steady_clock::time_point next_frame;
+
+	void Open(int frames_per_second);
+
+	// Call after EndDrawing, or after PollInputEvents on a frame that skipped drawing.
+	void EndFrame();
+};
+
+inline WindowPacer window_pacer;